@@ -29,6 +29,9 @@ void AssetStore::ClearAssets()
             TTF_CloseFont(font.second);
     }
     fonts.clear();
+
+    textureFiles.clear();
+    fontFiles.clear();
 }
 
 void AssetStore::AddTexture(SDL_Renderer* renderer, const std::string& assetId, const std::string& filePath)
@@ -38,6 +41,7 @@ void AssetStore::AddTexture(SDL_Renderer* renderer, const std::string& assetId,
     SDL_FreeSurface(surface);
     
     textures.emplace(assetId, texture);
+    textureFiles.emplace(assetId, filePath);
 
     Logger::Log("New texture added with id " + assetId);
 }
@@ -45,6 +49,7 @@ void AssetStore::AddTexture(SDL_Renderer* renderer, const std::string& assetId,
 void AssetStore::AddFont(const std::string& assetId, const std::string& filePath, int fontSize)
 {
     fonts.emplace(assetId, TTF_OpenFont(filePath.c_str(), fontSize));
+    fontFiles.emplace(assetId, std::make_pair(filePath, fontSize));
     Logger::Log("New font added with id " + assetId);
 }
 
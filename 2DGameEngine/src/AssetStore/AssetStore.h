@@ -2,6 +2,7 @@
 
 #include <string>
 #include <map>
+#include <utility>
 
 #include <SDL.h>
 #include <SDL_ttf.h>
@@ -18,9 +19,15 @@ public:
     void AddFont(const std::string& assetId, const std::string& filePath, int fontSize);
     SDL_Texture* GetTexture(const std::string& assetId);
     TTF_Font* GetFont(const std::string& assetId);
+
+    // The files every asset was loaded from, so the same assets can be loaded again (e.g. by a snapshot)
+    const std::map<std::string, std::string>& GetTextureFiles() const { return textureFiles; }
+    const std::map<std::string, std::pair<std::string, int>>& GetFontFiles() const { return fontFiles; }
     
 private:
     std::map<std::string, SDL_Texture*> textures;
     std::map<std::string, TTF_Font*> fonts;
+    std::map<std::string, std::string> textureFiles;
+    std::map<std::string, std::pair<std::string, int>> fontFiles;
     // TODO: create a map for audio
 };
@@ -0,0 +1,130 @@
+#include "FrameBenchmark.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../Profiler/Profiler.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <fstream>
+#endif
+
+namespace
+{
+    std::string EscapeJson(const std::string& value)
+    {
+        std::string escaped;
+        for (char c : value)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    // Nearest-rank percentile of sorted samples
+    double Percentile(const std::vector<double>& sortedSamples, double percentile)
+    {
+        const auto rank = static_cast<size_t>(std::ceil(percentile * sortedSamples.size()));
+        return sortedSamples[std::max<size_t>(rank, 1) - 1];
+    }
+
+    double Mean(const std::vector<double>& samples)
+    {
+        double sum = 0.0;
+        for (double sample : samples)
+        {
+            sum += sample;
+        }
+        return sum / samples.size();
+    }
+}
+
+void FrameBenchmark::AddFrame()
+{
+    const auto frameTimes = Profiler::GetFrameTimes();
+    if (frameTimes.empty())
+        return;
+
+    zoneMilliseconds["Frame"].push_back(frameTimes.back());
+
+    // A zone can run several times in a frame (or at several depths), the frame gets their sum
+    std::map<std::string, double> frameZones;
+    for (const auto& zone : Profiler::GetLastFrameZones())
+    {
+        frameZones[zone.name] += zone.milliseconds;
+    }
+    for (const auto& zone : frameZones)
+    {
+        zoneMilliseconds[zone.first].push_back(zone.second);
+    }
+
+    numFrames++;
+}
+
+void FrameBenchmark::AddCounter(const std::string& name, double value)
+{
+    counters[name].push_back(value);
+}
+
+void FrameBenchmark::WriteReport(std::ostream& stream, const std::string& levelScript) const
+{
+    stream << "{\n";
+    stream << "  \"level\": \"" << EscapeJson(levelScript) << "\",\n";
+    stream << "  \"frames\": " << numFrames << ",\n";
+    stream << "  \"peakMemoryBytes\": " << GetPeakMemoryBytes() << ",\n";
+
+    stream << "  \"timingsMs\": {";
+    const char* separator = "\n";
+    for (const auto& zone : zoneMilliseconds)
+    {
+        std::vector<double> samples = zone.second;
+        std::sort(samples.begin(), samples.end());
+        stream << separator << "    \"" << EscapeJson(zone.first) << "\": {"
+            << "\"samples\": " << samples.size()
+            << ", \"mean\": " << Mean(samples)
+            << ", \"p50\": " << Percentile(samples, 0.50)
+            << ", \"p99\": " << Percentile(samples, 0.99)
+            << ", \"max\": " << samples.back() << "}";
+        separator = ",\n";
+    }
+    stream << "\n  },\n";
+
+    stream << "  \"counters\": {";
+    separator = "\n";
+    for (const auto& counter : counters)
+    {
+        stream << separator << "    \"" << EscapeJson(counter.first) << "\": {"
+            << "\"mean\": " << Mean(counter.second)
+            << ", \"max\": " << *std::max_element(counter.second.begin(), counter.second.end()) << "}";
+        separator = ",\n";
+    }
+    stream << "\n  }\n";
+    stream << "}\n";
+}
+
+std::uint64_t FrameBenchmark::GetPeakMemoryBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS memoryCounters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)))
+        return memoryCounters.PeakWorkingSetSize;
+    return 0;
+#else
+    // VmHWM is the peak resident set size, in kB
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return std::stoull(line.substr(6)) * 1024;
+    }
+    return 0;
+#endif
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @name FrameBenchmark
+ * @brief Records the frames of a headless benchmark run and reports them as JSON.
+ * Every frame adds the total frame time and the time of each profiled zone (see Profiler), summed by name,
+ * so the report has one entry per system. Counters (entities, collision pairs...) are sampled once per frame.
+ * Timings are reported as mean, p50, p99 and max in milliseconds, counters as mean and max.
+ */
+class FrameBenchmark
+{
+public:
+    // Records the frame that the profiler just ended
+    void AddFrame();
+    void AddCounter(const std::string& name, double value);
+
+    int GetNumFrames() const { return numFrames; }
+
+    void WriteReport(std::ostream& stream, const std::string& levelScript) const;
+
+    // Peak resident memory of the process in bytes, 0 when the platform doesn't tell
+    static std::uint64_t GetPeakMemoryBytes();
+
+private:
+    int numFrames = 0;
+
+    // Samples of every zone and counter, ordered by name so reports are easy to diff
+    std::map<std::string, std::vector<double>> zoneMilliseconds;
+    std::map<std::string, std::vector<double>> counters;
+};
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <SDL.h>
+#include "../Game/SimulationTime.h"
 
 struct AnimationComponent
 {
@@ -16,6 +16,6 @@ struct AnimationComponent
         this->currentFrame = 1;
         this->frameSpeedRate = frameSpeedRate;
         this->isLoop = isLoop;
-        this->startTime = SDL_GetTicks();
+        this->startTime = SimulationTime::GetTicks();
     }
 };
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <SDL.h>
+#include "../Game/SimulationTime.h"
 
 struct ProjectileComponent
 {
@@ -14,6 +14,6 @@ struct ProjectileComponent
         this->isFriendly = isFriendly;
         this->hitPercentDamage = hitPercentDamage;
         this->duration = duration;
-        this->startTime = SDL_GetTicks();
+        this->startTime = SimulationTime::GetTicks();
     }
 };
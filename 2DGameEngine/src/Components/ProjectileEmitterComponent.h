@@ -2,7 +2,7 @@
 
 #include <glm/glm.hpp>
 
-#include "SDL_timer.h"
+#include "../Game/SimulationTime.h"
 
 struct ProjectileEmitterComponent
 {
@@ -20,6 +20,6 @@ struct ProjectileEmitterComponent
         this->projectileDuration = projectileDuration;
         this->hitPercentDamage = hitPercentDamage;
         this->isFriendly = isFriendly;
-        this->lastEmissionTime = SDL_GetTicks();
+        this->lastEmissionTime = SimulationTime::GetTicks();
     }
 };
@@ -8,6 +8,6 @@ struct ScriptComponent
 
     ScriptComponent(sol::function func = sol::lua_nil)
     {
-        this->func = func;
+        this->func = std::move(func);
     }
 };
\ No newline at end of file
@@ -4,9 +4,16 @@
 
 int IComponent::nextId = 0;
 
+Registry* Entity::registry = nullptr;
+
 int Entity::GetId() const
 {
-    return id;
+    return static_cast<int>(id);
+}
+
+std::uint32_t Entity::GetGeneration() const
+{
+    return generation;
 }
 
 void Entity::Kill()
@@ -14,84 +21,144 @@ void Entity::Kill()
     registry->KillEntity(*this);
 }
 
+bool Entity::IsAlive() const
+{
+    return registry->IsAlive(*this);
+}
+
 void Entity::Tag(const std::string& tag)
 {
     registry->TagEntity(*this, tag);
 }
 
-void Registry::TagEntity(Entity entity, const std::string& tag)
+void Entity::Tag(TagId tag)
 {
-    entityPerTag.emplace(tag, entity);
-    tagPerEntity.emplace(entity.GetId(), tag);
+    registry->TagEntity(*this, tag);
 }
 
-bool Registry::EntityHasTag(Entity entity, const std::string& tag) const
+std::unordered_map<std::string, TagId> Registry::tagIds;
+std::unordered_map<std::string, GroupId> Registry::groupIds;
+
+TagId Registry::GetTagId(const std::string& tag)
+{
+    // Emplace keeps the existing id if the tag was already registered
+    return tagIds.emplace(tag, static_cast<TagId>(tagIds.size())).first->second;
+}
+
+GroupId Registry::GetGroupId(const std::string& group)
 {
-    if (tagPerEntity.find(entity.GetId()) == tagPerEntity.end())
+    auto existingGroup = groupIds.find(group);
+    if (existingGroup != groupIds.end())
+        return existingGroup->second;
+
+    if (groupIds.size() >= MAX_GROUPS)
     {
-        return false;
+        Logger::Err("Cannot register group '" + group + "', the maximum number of groups is " + std::to_string(MAX_GROUPS));
+        return -1;
     }
-    return entityPerTag.find(tag)->second == entity;
+    return groupIds.emplace(group, static_cast<GroupId>(groupIds.size())).first->second;
+}
+
+void Registry::TagEntity(Entity entity, const std::string& tag)
+{
+    TagEntity(entity, GetTagId(tag));
+}
+
+void Registry::TagEntity(Entity entity, TagId tag)
+{
+    RemoveEntityTag(entity);
+
+    if (tag >= static_cast<int>(entityPerTag.size()))
+        entityPerTag.resize(tag + 1, -1);
+
+    // A tag names a single entity, take it away from its previous owner
+    if (entityPerTag[tag] != -1)
+        tagPerEntity[entityPerTag[tag]] = -1;
+
+    entityPerTag[tag] = entity.GetId();
+    tagPerEntity[entity.GetId()] = tag;
+}
+
+bool Registry::EntityHasTag(Entity entity, const std::string& tag) const
+{
+    auto tagId = tagIds.find(tag);
+    return tagId != tagIds.end() && EntityHasTag(entity, tagId->second);
+}
+
+bool Registry::EntityHasTag(Entity entity, TagId tag) const
+{
+    // Invalid handles (e.g. a missed GetEntityByTag or a command buffer placeholder) have no tag
+    const int entityId = entity.GetId();
+    return entityId >= 0 && entityId < static_cast<int>(tagPerEntity.size()) && tagPerEntity[entityId] == tag;
 }
 
 Entity Registry::GetEntityByTag(const std::string& tag) const
 {
-    return entityPerTag.at(tag);
+    auto tagId = tagIds.find(tag);
+    if (tagId == tagIds.end() || tagId->second >= static_cast<int>(entityPerTag.size()) || entityPerTag[tagId->second] == -1)
+    {
+        Logger::Err("No entity is tagged '" + tag + "'");
+        return Entity(-1);
+    }
+
+    const int entityId = entityPerTag[tagId->second];
+    return Entity(entityId, entityGenerations[entityId]);
 }
 
 void Registry::RemoveEntityTag(Entity entity)
 {
-    auto taggedEntity = tagPerEntity.find(entity.GetId());
-    if (taggedEntity != tagPerEntity.end())
+    TagId& tag = tagPerEntity[entity.GetId()];
+    if (tag != -1)
     {
-        auto tag = taggedEntity->second;
-        entityPerTag.erase(tag);
-        tagPerEntity.erase(taggedEntity);
+        entityPerTag[tag] = -1;
+        tag = -1;
     }
 }
 
 void Registry::GroupEntity(Entity entity, const std::string& group)
 {
-    entitiesPerGroup.emplace(group, std::set<Entity>());
-    entitiesPerGroup[group].emplace(entity);
-    groupPerEntity.emplace(entity.GetId(), group);
+    GroupEntity(entity, GetGroupId(group));
+}
+
+void Registry::GroupEntity(Entity entity, GroupId group)
+{
+    if (group < 0)
+        return;
+    groupsPerEntity[entity.GetId()].set(group);
 }
 
 bool Registry::EntityBelongsToGroup(Entity entity, const std::string& group) const
 {
-    if (entitiesPerGroup.find(group) == entitiesPerGroup.end())
-        return false;
-    
-    auto groupEntities = entitiesPerGroup.at(group);
-    return groupEntities.find(entity) != groupEntities.end();
+    auto groupId = groupIds.find(group);
+    return groupId != groupIds.end() && EntityBelongsToGroup(entity, groupId->second);
+}
+
+bool Registry::EntityBelongsToGroup(Entity entity, GroupId group) const
+{
+    // Invalid handles (e.g. a missed GetEntityByTag or a command buffer placeholder) belong to no group
+    const int entityId = entity.GetId();
+    return group >= 0 && entityId >= 0 && entityId < static_cast<int>(groupsPerEntity.size()) && groupsPerEntity[entityId].test(group);
 }
 
 std::vector<Entity> Registry::GetEntitiesByGroup(const std::string& group) const
 {
-    if (entitiesPerGroup.find(group) == entitiesPerGroup.end())
+    auto groupId = groupIds.find(group);
+    if (groupId == groupIds.end())
         return {};
-    
-    auto& setOfEntities = entitiesPerGroup.at(group);
-    return std::vector<Entity>(setOfEntities.begin(), setOfEntities.end());
+
+    // Killed entities have their group bits cleared, so every match is a live entity
+    std::vector<Entity> entities;
+    for (int entityId = 0; entityId < static_cast<int>(groupsPerEntity.size()); entityId++)
+    {
+        if (groupsPerEntity[entityId].test(groupId->second))
+            entities.emplace_back(entityId, entityGenerations[entityId]);
+    }
+    return entities;
 }
 
 void Registry::RemoveEntityGroup(Entity entity)
 {
-    // if in group, remove entity from group management
-    auto groupedEntity = groupPerEntity.find(entity.GetId());
-    if (groupedEntity != groupPerEntity.end())
-    {
-        auto group = entitiesPerGroup.find(groupedEntity->second);
-        if (group != entitiesPerGroup.end())
-        {
-            auto entityInGroup = group->second.find(entity);
-            if (entityInGroup != group->second.end())
-            {
-                group->second.erase(entityInGroup);
-            }
-        }
-        groupPerEntity.erase(groupedEntity);
-    }
+    groupsPerEntity[entity.GetId()].reset();
 }
 
 bool Entity::HasTag(const std::string& tag) const
@@ -99,35 +166,111 @@ bool Entity::HasTag(const std::string& tag) const
     return registry->EntityHasTag(*this, tag);
 }
 
+bool Entity::HasTag(TagId tag) const
+{
+    return registry->EntityHasTag(*this, tag);
+}
+
 void Entity::Group(const std::string& group)
 {
     registry->GroupEntity(*this, group);
 }
 
+void Entity::Group(GroupId group)
+{
+    registry->GroupEntity(*this, group);
+}
+
 bool Entity::BelongsToGroup(const std::string& group) const
 {
     return registry->EntityBelongsToGroup(*this, group);
 }
 
+bool Entity::BelongsToGroup(GroupId group) const
+{
+    return registry->EntityBelongsToGroup(*this, group);
+}
+
 void System::AddEntityToSystem(Entity entity)
 {
+    const auto entityId = entity.GetId();
+    if (entityId >= static_cast<int>(entityIndices.size()))
+        entityIndices.resize(entityId + 1, -1);
+    else if (entityIndices[entityId] != -1)
+        return;
+
+    entityIndices[entityId] = static_cast<int>(entities.size());
     entities.push_back(entity);
+    membershipVersion++;
 }
 
 void System::RemoveEntityFromSystem(Entity entity)
 {
-    entities.erase(
-        std::remove_if(
-            entities.begin(),
-            entities.end(),
-            [&entity](Entity other)
-                { return entity == other; }
-            ),
-            entities.end()
-        );
+    if (!HasEntity(entity))
+        return;
+
+    const auto entityId = entity.GetId();
+    const int indexOfRemoved = entityIndices[entityId];
+    entityIndices[entityId] = -1;
+    membershipVersion++;
+
+    if (isStableOrder)
+    {
+        // Leave a hole that FlushRemovedEntities() closes, so the order of the others is preserved
+        hasRemovedEntities = true;
+        return;
+    }
+
+    // Move the last entity into the removed slot to keep the vector packed
+    const Entity last = entities.back();
+    entities.pop_back();
+    if (indexOfRemoved < static_cast<int>(entities.size()))
+    {
+        entities[indexOfRemoved] = last;
+        entityIndices[last.GetId()] = indexOfRemoved;
+    }
+}
+
+bool System::HasEntity(Entity entity) const
+{
+    const auto entityId = entity.GetId();
+    return entityId < static_cast<int>(entityIndices.size())
+        && entityIndices[entityId] != -1
+        && entities[entityIndices[entityId]] == entity;
 }
 
-std::vector<Entity> System::GetSystemEntities() const
+void System::FlushRemovedEntities()
+{
+    if (!hasRemovedEntities)
+        return;
+
+    // Keep the entities that are still registered at their slot, in their original order
+    int count = 0;
+    for (int i = 0; i < static_cast<int>(entities.size()); i++)
+    {
+        const Entity entity = entities[i];
+        if (entityIndices[entity.GetId()] != i)
+            continue;
+        entityIndices[entity.GetId()] = count;
+        entities[count++] = entity;
+    }
+    entities.erase(entities.begin() + count, entities.end());
+    hasRemovedEntities = false;
+}
+
+void System::SetStableOrder(bool isStable)
+{
+    FlushRemovedEntities();
+    isStableOrder = isStable;
+}
+
+void System::SetExclusive(bool isExclusive)
+{
+    this->isExclusive = isExclusive;
+    hasDeclaredAccess = true;
+}
+
+const std::vector<Entity>& System::GetSystemEntities() const
 {
     return entities;
 }
@@ -137,6 +280,186 @@ const Signature& System::GetComponentSignature() const
     return componentSignature;
 }
 
+Archetype::Archetype(const Signature& signature, const std::vector<ComponentInfo>& componentInfos)
+    : signature(signature)
+{
+    columnOffsets.fill(0);
+    componentSizes.fill(0);
+
+    // Work out how many rows fit in a chunk, leaving room for the alignment padding of each column
+    size_t rowSize = sizeof(Entity);
+    size_t padding = 0;
+    for (int componentId = 0; componentId < static_cast<int>(MAX_COMPONENTS); componentId++)
+    {
+        if (!signature.test(componentId))
+            continue;
+        const ComponentInfo& info = componentInfos[componentId];
+        columns.push_back({componentId, 0, info});
+        componentSizes[componentId] = info.size;
+        rowSize += info.size;
+        padding += info.alignment;
+    }
+    chunkCapacity = std::max(1, static_cast<int>((CHUNK_SIZE - std::min(padding, CHUNK_SIZE)) / rowSize));
+
+    // The entity array goes first, followed by one aligned array per component type
+    size_t offset = sizeof(Entity) * chunkCapacity;
+    for (auto& column : columns)
+    {
+        offset = (offset + column.info.alignment - 1) / column.info.alignment * column.info.alignment;
+        column.offset = offset;
+        columnOffsets[column.componentId] = offset;
+        offset += column.info.size * chunkCapacity;
+    }
+    chunkBytes = std::max(offset, CHUNK_SIZE);
+}
+
+Archetype::~Archetype()
+{
+    // Chunks are raw memory, so the components still alive have to be destroyed by hand
+    for (int chunk = 0; chunk < GetNumChunks(); chunk++)
+    {
+        for (int row = 0; row < chunks[chunk].count; row++)
+        {
+            for (const auto& column : columns)
+                column.info.destroy(GetComponent(chunk, row, column.componentId));
+        }
+    }
+}
+
+Entity* Archetype::GetEntities(int chunk) const
+{
+    return reinterpret_cast<Entity*>(GetChunkMemory(chunk));
+}
+
+void* Archetype::GetColumn(int chunk, int componentId) const
+{
+    return GetChunkMemory(chunk) + columnOffsets[componentId];
+}
+
+void* Archetype::GetComponent(int chunk, int row, int componentId) const
+{
+    return GetChunkMemory(chunk) + columnOffsets[componentId] + row * componentSizes[componentId];
+}
+
+std::pair<int, int> Archetype::AllocateRow(Entity entity)
+{
+    if (chunks.empty() || chunks.back().count == chunkCapacity)
+    {
+        Chunk chunk;
+        chunk.memory = std::make_unique<CacheLine[]>((chunkBytes + sizeof(CacheLine) - 1) / sizeof(CacheLine));
+        chunks.push_back(std::move(chunk));
+    }
+
+    const int chunk = static_cast<int>(chunks.size()) - 1;
+    const int row = chunks[chunk].count++;
+    new (GetEntities(chunk) + row) Entity(entity);
+    return {chunk, row};
+}
+
+int Archetype::RemoveRow(int chunk, int row)
+{
+    for (const auto& column : columns)
+    {
+        column.info.destroy(GetComponent(chunk, row, column.componentId));
+    }
+
+    // Fill the hole with the last row, so every chunk but the last one stays full
+    const int lastChunk = static_cast<int>(chunks.size()) - 1;
+    const int lastRow = chunks[lastChunk].count - 1;
+    int movedEntityId = -1;
+    if (chunk != lastChunk || row != lastRow)
+    {
+        for (const auto& column : columns)
+        {
+            void* last = GetComponent(lastChunk, lastRow, column.componentId);
+            column.info.moveConstruct(GetComponent(chunk, row, column.componentId), last);
+            column.info.destroy(last);
+        }
+        GetEntities(chunk)[row] = GetEntities(lastChunk)[lastRow];
+        movedEntityId = GetEntities(chunk)[row].GetId();
+    }
+
+    if (--chunks[lastChunk].count == 0)
+        chunks.pop_back();
+
+    return movedEntityId;
+}
+
+ArchetypeStorage::EntityLocation& ArchetypeStorage::GetLocation(int entityId)
+{
+    if (entityId >= static_cast<int>(entityLocations.size()))
+        entityLocations.resize(entityId + 1);
+    return entityLocations[entityId];
+}
+
+Archetype& ArchetypeStorage::GetOrCreateArchetype(const Signature& signature)
+{
+    auto& archetype = archetypes[signature];
+    if (!archetype)
+    {
+        archetype = std::make_unique<Archetype>(signature, componentInfos);
+        archetypeList.push_back(archetype.get());
+    }
+    return *archetype;
+}
+
+ArchetypeStorage::EntityLocation& ArchetypeStorage::MoveEntity(Entity entity, Archetype& target)
+{
+    EntityLocation& location = GetLocation(entity.GetId());
+    const EntityLocation source = location;
+    const auto [chunk, row] = target.AllocateRow(entity);
+
+    if (source.archetype)
+    {
+        // Move the components shared by both archetypes, the source row is destroyed afterwards
+        for (int componentId = 0; componentId < static_cast<int>(MAX_COMPONENTS); componentId++)
+        {
+            if (source.archetype->HasComponent(componentId) && target.HasComponent(componentId))
+            {
+                componentInfos[componentId].moveConstruct(
+                    target.GetComponent(chunk, row, componentId),
+                    source.archetype->GetComponent(source.chunk, source.row, componentId)
+                );
+            }
+        }
+
+        const int movedEntityId = source.archetype->RemoveRow(source.chunk, source.row);
+        if (movedEntityId != -1)
+            entityLocations[movedEntityId] = source;
+    }
+
+    location = {&target, chunk, row};
+    return location;
+}
+
+void ArchetypeStorage::RemoveEntity(int entityId)
+{
+    if (entityId >= static_cast<int>(entityLocations.size()))
+        return;
+
+    EntityLocation& location = entityLocations[entityId];
+    if (!location.archetype)
+        return;
+
+    const int movedEntityId = location.archetype->RemoveRow(location.chunk, location.row);
+    if (movedEntityId != -1)
+        entityLocations[movedEntityId] = location;
+    location = EntityLocation();
+}
+
+Registry::Registry(StorageMode storageMode) : storageMode(storageMode)
+{
+    Logger::Log("Registry constructor.");
+    Entity::registry = this;
+}
+
+Registry::~Registry()
+{
+    if (Entity::registry == this)
+        Entity::registry = nullptr;
+    Logger::Log("Registry destructor.");
+}
+
 Entity Registry::CreateEntity()
 {
     int entityId;
@@ -146,7 +469,14 @@ Entity Registry::CreateEntity()
         // If there are no free ids waiting to be reused
         entityId = numEntities++;
         if (entityId >= static_cast<int>(entityComponentSignatures.size()))
+        {
             entityComponentSignatures.resize(entityId + 1);
+            entitySystemSignatures.resize(entityId + 1);
+            isEntityPending.resize(entityId + 1, false);
+            tagPerEntity.resize(entityId + 1, -1);
+            groupsPerEntity.resize(entityId + 1);
+            entityGenerations.resize(entityId + 1, 0);
+        }
     }
     else
     {
@@ -155,52 +485,178 @@ Entity Registry::CreateEntity()
         freeIds.pop_front();
     }
     
-    Entity entity(entityId);
-    entity.registry = this;
-    entitiesToBeAdded.insert(entity);
+    Entity entity(entityId, entityGenerations[entityId]);
+    entitiesToBeAdded.push_back(entity);
+    isEntityPending[entityId] = true;
     return entity;
 }
 
 void Registry::KillEntity(Entity entity)
 {
-    entitiesToBeKilled.insert(entity);
+    // Ignore stale handles, they must not kill the entity that reused their slot
+    if (!IsAlive(entity))
+        return;
+    entitiesToBeKilled.push_back(entity);
+}
+
+bool Registry::IsAlive(Entity entity) const
+{
+    const auto entityId = static_cast<size_t>(entity.GetId());
+    return entityId < entityGenerations.size() && entityGenerations[entityId] == entity.GetGeneration();
+}
+
+const std::vector<System*>& Registry::GetSystemsMatching(const Signature& signature)
+{
+    auto cached = systemsPerSignature.find(signature);
+    if (cached != systemsPerSignature.end())
+        return cached->second;
+
+    // First time this signature shows up, test it against every system once
+    std::vector<System*> matchingSystems;
+    for (auto& system : systems)
+    {
+        const Signature& systemSignature = system.second->GetComponentSignature();
+        if ((signature & systemSignature) == systemSignature)
+            matchingSystems.push_back(system.second.get());
+    }
+    return systemsPerSignature.emplace(signature, std::move(matchingSystems)).first->second;
 }
 
 void Registry::AddEntityToSystems(Entity entity)
 {
     const auto entityId = entity.GetId();
-    for (auto& s : systems)
+
+    // Add the entity to every system whose signature matches.
+    for (System* system : GetSystemsMatching(entityComponentSignatures[entityId]))
+        system->AddEntityToSystem(entity);
+    entitySystemSignatures[entityId] = entityComponentSignatures[entityId];
+}
+
+void Registry::RemoveEntityFromSystems(Entity entity)
+{
+    const auto entityId = entity.GetId();
+
+    // Remove entity from every system that has it.
+    for (System* system : GetSystemsMatching(entitySystemSignatures[entityId]))
+        system->RemoveEntityFromSystem(entity);
+    entitySystemSignatures[entityId].reset();
+}
+
+void Registry::OnSignatureChanged(Entity entity)
+{
+    // Entities waiting to join their systems pick up the new signature anyway
+    const auto entityId = entity.GetId();
+    if (isEntityPending[entityId])
+        return;
+
+    isEntityPending[entityId] = true;
+    entitiesToBeRefreshed.push_back(entity);
+}
+
+void Registry::RefreshEntityInSystems(Entity entity)
+{
+    const auto entityId = entity.GetId();
+    const Signature& oldSignature = entitySystemSignatures[entityId];
+    const Signature& newSignature = entityComponentSignatures[entityId];
+    if (oldSignature == newSignature)
+        return;
+
+    // Leave the systems that required a component the entity lost
+    for (System* system : GetSystemsMatching(oldSignature))
     {
-        if ((entityComponentSignatures[entityId] & s.second->GetComponentSignature()) == s.second->GetComponentSignature())
-        {
-            // Add the entity to the system if signature matches.
-            s.second->AddEntityToSystem(entity);
-        }
+        const Signature& systemSignature = system->GetComponentSignature();
+        if ((newSignature & systemSignature) != systemSignature)
+            system->RemoveEntityFromSystem(entity);
     }
+
+    // Join the systems that only match now
+    for (System* system : GetSystemsMatching(newSignature))
+    {
+        const Signature& systemSignature = system->GetComponentSignature();
+        if ((oldSignature & systemSignature) != systemSignature)
+            system->AddEntityToSystem(entity);
+    }
+    entitySystemSignatures[entityId] = newSignature;
 }
 
-void Registry::RemoveEntityFromSystems(Entity entity)
+void Registry::Instantiate(const Prefab& prefab, int count)
 {
-    for (auto system : systems)
+    Instantiate(prefab, count, [](Entity, int) {});
+}
+
+Entity Registry::Instantiate(const Prefab& prefab)
+{
+    Entity instance(0);
+    Instantiate(prefab, 1, [&instance](Entity entity, int) { instance = entity; });
+    return instance;
+}
+
+Prefab& Prefab::Group(const std::string& group)
+{
+    return Group(Registry::GetGroupId(group));
+}
+
+Prefab& Prefab::Group(GroupId group)
+{
+    if (group >= 0)
+        groups.set(group);
+    return *this;
+}
+
+CommandBuffer& Registry::CreateCommandBuffer()
+{
+    std::lock_guard<std::mutex> lock(commandBufferMutex);
+
+    if (freeCommandBuffers.empty())
     {
-        // Remove entity if the system has it.
-        if ((entityComponentSignatures[entity.GetId()] & system.second->GetComponentSignature()) == system.second->GetComponentSignature())
-            system.second->RemoveEntityFromSystem(entity);
+        pendingCommandBuffers.push_back(std::make_unique<CommandBuffer>());
     }
+    else
+    {
+        pendingCommandBuffers.push_back(std::move(freeCommandBuffers.back()));
+        freeCommandBuffers.pop_back();
+    }
+    return *pendingCommandBuffers.back();
 }
 
 void Registry::Update()
 {
+    // Start a new change tick, everything written from now on counts as newer than the previous frame
+    changeTick++;
+
+    // Apply the structural changes recorded in command buffers, they join the add/kill lists below
+    for (auto& commandBuffer : pendingCommandBuffers)
+    {
+        commandBuffer->Playback(*this);
+        freeCommandBuffers.push_back(std::move(commandBuffer));
+    }
+    pendingCommandBuffers.clear();
+
     // Processing the entities that are waiting to be created to the active Systems
     for (auto entity : entitiesToBeAdded)
     {
         AddEntityToSystems(entity);
+        isEntityPending[entity.GetId()] = false;
     }
     entitiesToBeAdded.clear();
+
+    // Processing the entities that gained or lost components since they joined their systems
+    for (auto entity : entitiesToBeRefreshed)
+    {
+        isEntityPending[entity.GetId()] = false;
+        if (IsAlive(entity))
+            RefreshEntityInSystems(entity);
+    }
+    entitiesToBeRefreshed.clear();
     
     // Processing the entities that are waiting to be killed to the active Systems
     for (auto entity : entitiesToBeKilled)
     {
+        // An entity killed several times in the same frame is only removed once, the first
+        // removal bumps its generation and turns the other requests into stale handles
+        if (!IsAlive(entity))
+            continue;
+
         RemoveEntityFromSystems(entity);
 
         // Reset the entity's component signature.
@@ -212,8 +668,10 @@ void Registry::Update()
             if (pool)
                 pool->RemoveEntityFromPool(entity.GetId());
         }
+        archetypeStorage.RemoveEntity(entity.GetId());
         
-        // Make the entity id available to be reused
+        // Make the entity id available to be reused, invalidating every handle to the old entity
+        entityGenerations[entity.GetId()]++;
         freeIds.push_back(entity.GetId());
 
         // Remove any traces of that entity from the tag/group maps
@@ -221,4 +679,88 @@ void Registry::Update()
         RemoveEntityGroup(entity);
     }
     entitiesToBeKilled.clear();
+
+    // Close the holes left in the systems that keep their entities in insertion order
+    for (auto& system : systems)
+    {
+        system.second->FlushRemovedEntities();
+    }
+}
+
+CommandBuffer::~CommandBuffer()
+{
+    Clear();
+}
+
+void* CommandBuffer::Allocate(size_t size, size_t alignment)
+{
+    while (true)
+    {
+        if (currentBlock < arenaBlocks.size())
+        {
+            ArenaBlock& block = arenaBlocks[currentBlock];
+            const size_t offset = (blockOffset + alignment - 1) & ~(alignment - 1);
+            if (offset + size <= block.capacity)
+            {
+                blockOffset = offset + size;
+                return reinterpret_cast<std::byte*>(block.memory.get()) + offset;
+            }
+
+            // Move on to the next block, left over from a previous frame or allocated below
+            currentBlock++;
+            blockOffset = 0;
+            continue;
+        }
+
+        const size_t capacity = std::max(size, ARENA_BLOCK_SIZE);
+        const size_t count = (capacity + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+        arenaBlocks.push_back({ std::make_unique<std::max_align_t[]>(count), count * sizeof(std::max_align_t) });
+    }
+}
+
+Entity CommandBuffer::Resolve(Entity entity) const
+{
+    if (entity.GetId() >= 0)
+        return entity;
+    return createdEntities[-1 - entity.GetId()];
+}
+
+Entity CommandBuffer::CreateEntity()
+{
+    Record<CreateEntityCommand>();
+
+    // Placeholders use negative ids so they can never be mistaken for a live entity
+    return Entity(-1 - numPlaceholders++);
+}
+
+void CommandBuffer::KillEntity(Entity entity)
+{
+    Record<KillEntityCommand>(entity);
+}
+
+void CommandBuffer::Playback(Registry& registry)
+{
+    createdEntities.reserve(numPlaceholders);
+    for (Command* command = firstCommand; command; command = command->next)
+    {
+        command->Execute(registry, *this);
+    }
+    Clear();
+}
+
+void CommandBuffer::Clear()
+{
+    Command* command = firstCommand;
+    while (command)
+    {
+        Command* next = command->next;
+        command->~Command();
+        command = next;
+    }
+    firstCommand = nullptr;
+    lastCommand = nullptr;
+    currentBlock = 0;
+    blockOffset = 0;
+    numPlaceholders = 0;
+    createdEntities.clear();
 }
@@ -1,9 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <bitset>
+#include <cstddef>
+#include <cstdint>
 #include <deque>
 #include <memory>
-#include <set>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <type_traits>
 #include <typeindex>
 #include <unordered_map>
 #include <vector>
@@ -18,6 +25,16 @@ const unsigned int MAX_COMPONENTS = 32;
  */
 typedef std::bitset<MAX_COMPONENTS> Signature;
 
+const unsigned int MAX_GROUPS = 32;
+
+/**
+ * @brief Tag and group names are interned to small integer ids the first time they are used.
+ * Every entity keeps one bit per group, so checking a membership is a single bit test.
+ */
+typedef int TagId;
+typedef int GroupId;
+typedef std::bitset<MAX_GROUPS> GroupMask;
+
 struct IComponent
 {
 protected:
@@ -39,40 +56,50 @@ public:
 
 /**
  * @name Entity
- * @brief 
+ * @brief An entity is just a handle: the index of its slot in the registry plus the generation of that slot.
+ * The registry bumps the generation every time a slot is recycled, so stale copies of a killed entity
+ * can be detected with Registry::IsAlive() instead of silently aliasing the new entity.
  */
 class Entity
 {
 private:
-    int id;
+    std::uint32_t id;
+    std::uint32_t generation;
     
 public:
-    Entity(int id) : id(id) {};
+    explicit Entity(int id, std::uint32_t generation = 0) : id(static_cast<std::uint32_t>(id)), generation(generation) {};
     Entity(const Entity& entity) = default;
     int GetId() const;
+    std::uint32_t GetGeneration() const;
 
     // Kill the entity
     void Kill();
+    bool IsAlive() const;
 
     // Manage entity tags and groups
     void Tag(const std::string& tag);
+    void Tag(TagId tag);
     bool HasTag(const std::string& tag) const;
+    bool HasTag(TagId tag) const;
     void Group(const std::string& group);
+    void Group(GroupId group);
     bool BelongsToGroup(const std::string& group) const;
+    bool BelongsToGroup(GroupId group) const;
 
     Entity& operator =(const Entity& other) = default;
-    bool operator ==(const Entity& other) const { return this->GetId() == other.GetId(); }
-    bool operator !=(const Entity& other) const { return this->GetId() != other.GetId(); }
-    bool operator >(const Entity& other) const { return this->GetId() > other.GetId(); }
-    bool operator <(const Entity& other) const { return this->GetId() < other.GetId(); }
+    bool operator ==(const Entity& other) const { return id == other.id && generation == other.generation; }
+    bool operator !=(const Entity& other) const { return !(*this == other); }
+    bool operator >(const Entity& other) const { return other < *this; }
+    bool operator <(const Entity& other) const { return id < other.id || (id == other.id && generation < other.generation); }
 
     template <typename TComponent, typename ...TArgs> void AddComponent(TArgs&& ...args);
     template <typename TComponent> void RemoveComponent();
     template <typename TComponent> bool HasComponent() const;
     template <typename TComponent> TComponent& GetComponent() const;
     
-    // Hold a pointer to the entity's owner registry.
-    class Registry* registry;
+    // Pointer to the registry that owns all entities. It is shared by every entity instead of
+    // being stored per handle, so an Entity stays 8 bytes.
+    static class Registry* registry;
 };
 
 /**
@@ -84,6 +111,23 @@ class System
 private:
     Signature componentSignature;
     std::vector<Entity> entities;
+
+    // Slot of every entity inside the entities vector, so removing it doesn't need a search.
+    // [Vector index = entity id], -1 when the entity is not part of the system
+    std::vector<int> entityIndices;
+
+    // Stable systems keep insertion order: removed slots are compacted in one pass by FlushRemovedEntities()
+    bool isStableOrder = false;
+    bool hasRemovedEntities = false;
+
+    // Bumped every time an entity joins or leaves the system
+    std::uint32_t membershipVersion = 0;
+
+    // Components the system reads and writes in its update, for the SystemScheduler
+    Signature readSignature;
+    Signature writeSignature;
+    bool hasDeclaredAccess = false;
+    bool isExclusive = false;
     
 public:
     System() = default;
@@ -91,11 +135,36 @@ public:
 
     void AddEntityToSystem(Entity entity);
     void RemoveEntityFromSystem(Entity entity);
-    std::vector<Entity> GetSystemEntities() const;
+    bool HasEntity(Entity entity) const;
+
+    // Compacts the entity list of a stable-order system after removals (called by Registry::Update).
+    void FlushRemovedEntities();
+
+    // Returns the live list of entities without copying it. Membership only changes inside
+    // Registry::Update(), so systems can create or kill entities while iterating: the list is
+    // only updated at the next registry update and the iteration is never invalidated.
+    const std::vector<Entity>& GetSystemEntities() const;
     const Signature& GetComponentSignature() const;
 
+    // Lets systems that cache data derived from their entity list know when it needs rebuilding.
+    std::uint32_t GetMembershipVersion() const { return membershipVersion; }
+
     // Defines the component type that entities must have to be considered by the system.
     template <typename TComponent> void RequireComponent();
+
+    // By default removing an entity swaps the last entity into its slot. Systems that rely on
+    // the insertion order of their entities can ask to keep it instead.
+    void SetStableOrder(bool isStable);
+
+    // Declares the components the update reads and writes, so the scheduler can run it next to the
+    // systems it doesn't conflict with. An exclusive system (creating entities, emitting events, using
+    // state outside the registry...) always runs alone, and so does a system that declares nothing.
+    template <typename TComponent> void ReadsComponent();
+    template <typename TComponent> void WritesComponent();
+    void SetExclusive(bool isExclusive);
+    const Signature& GetReadSignature() const { return readSignature; }
+    const Signature& GetWriteSignature() const { return writeSignature; }
+    bool IsExclusive() const { return isExclusive || !hasDeclaredAccess; }
 };
 
 class IPool
@@ -103,96 +172,177 @@ class IPool
 public:
     virtual ~IPool() = default;
     virtual void RemoveEntityFromPool(int entityId) = 0;
+    virtual int GetSize() const = 0;
+
+    // Packed ids of the entities that have a component in the pool
+    virtual const std::vector<int>& GetEntityIds() const = 0;
 };
 
 /**
  * @name Pool
- * @brief A pool is just a vector (contiguous data) of objects of type T
+ * @brief A pool is a sparse set: a vector (contiguous data) of objects of type T packed next to
+ * the entity id that owns each element, plus a paged sparse array to find them by entity id.
  */
 template <typename T>
 class Pool : public IPool
 {
 private:
+    // Packed component data, data[i] belongs to the entity stored in entityIds[i].
+    // Only live components are constructed: spare capacity stays raw memory, so growing the pool never
+    // default-constructs components and move-only component types are supported.
     std::vector<T> data;
+    std::vector<int> entityIds;
     int size;
 
-    // Helper maps to keep track of entity ids per index, so the vector is always packed.
-    std::unordered_map<int, int> entityIdToIndex;
-    std::unordered_map<int, int> indexToEntityId;
+    // Registry change tick of the last write to every component, changeTicks[i] belongs to data[i].
+    std::vector<std::uint32_t> changeTicks;
+
+    // Sparse array split into fixed-size pages that are only allocated when an entity id lands in them.
+    // [Page = entity id / SPARSE_PAGE_SIZE], [Page index = entity id % SPARSE_PAGE_SIZE] -> dense index
+    static constexpr int SPARSE_PAGE_SIZE = 4096;
+    static constexpr int INVALID_INDEX = -1;
+    std::vector<std::unique_ptr<int[]>> sparsePages;
+
+    // Returns the dense index of the entity or INVALID_INDEX if the entity has no component in this pool.
+    int GetIndex(int entityId) const
+    {
+        const size_t page = entityId / SPARSE_PAGE_SIZE;
+        if (page >= sparsePages.size() || !sparsePages[page])
+            return INVALID_INDEX;
+        return sparsePages[page][entityId % SPARSE_PAGE_SIZE];
+    }
+
+    // Returns the sparse slot of the entity, allocating its page if necessary.
+    int& GetSparseSlot(int entityId)
+    {
+        const size_t page = entityId / SPARSE_PAGE_SIZE;
+        if (page >= sparsePages.size())
+            sparsePages.resize(page + 1);
+        if (!sparsePages[page])
+        {
+            sparsePages[page] = std::make_unique<int[]>(SPARSE_PAGE_SIZE);
+            std::fill_n(sparsePages[page].get(), SPARSE_PAGE_SIZE, INVALID_INDEX);
+        }
+        return sparsePages[page][entityId % SPARSE_PAGE_SIZE];
+    }
 
 public:
-    Pool(int capacity = 100)
+    Pool(int capacity = 0)
     {
         size = 0;
-        data.resize(capacity);
+        Reserve(capacity);
     }
 
     virtual ~Pool() = default;
 
     bool IsEmpty() const { return size == 0; }
-    int GetSize() const { return size; }
-    void Resize(int n) { data.resize(n); }
-    void Clear() { data.clear(); size = 0; }
+    int GetSize() const override { return size; }
+    const std::vector<int>& GetEntityIds() const override { return entityIds; }
+    void Reserve(int n) { data.reserve(n); entityIds.reserve(n); changeTicks.reserve(n); }
+    void Clear() { data.clear(); entityIds.clear(); changeTicks.clear(); sparsePages.clear(); size = 0; }
 
-    /*void Add(T object)
-    {
-        data.push_back(object);
-    }*/
+    bool Has(int entityId) const { return GetIndex(entityId) != INVALID_INDEX; }
 
-    void Set(int entityId, T object)
+    // Constructs the component of the entity directly in the pool storage from the given arguments.
+    template <typename ...TArgs>
+    T& Emplace(int entityId, TArgs&& ...args)
     {
-        if (entityIdToIndex.find(entityId) != entityIdToIndex.end())
+        int& index = GetSparseSlot(entityId);
+        if (index != INVALID_INDEX)
         {
             //If the element already exists, simply replace the component object
-            int index = entityIdToIndex[entityId];
-            data[index] = object;
-        }
-        else
-        {
-            // When adding a new object, we keep track of the entity ids and their vector index
-            int index = size;
-            entityIdToIndex.emplace(entityId, index);
-            indexToEntityId.emplace(index, entityId);
-            if (index >= data.capacity())
-            {
-                // If necessary, we resize by always doubling the current capacity.
-                data.resize(size * 2);
-            }
-            data[index] = object;
-            size++;
+            data[index] = T(std::forward<TArgs>(args)...);
+            return data[index];
         }
+
+        // When adding a new object, we keep track of the entity id that owns the new vector index
+        index = size;
+        entityIds.push_back(entityId);
+        changeTicks.push_back(0);
+        data.emplace_back(std::forward<TArgs>(args)...);
+        size++;
+        return data.back();
     }
 
-    void Remove(int entityId)
+    void Set(int entityId, T object)
     {
-        // Copy the last element to the delete position to keep the array packed
-        int indexOfRemoved = entityIdToIndex[entityId];
-        int indexOfLast = size - 1;
-        data[indexOfRemoved] = data[indexOfLast];
-
-        // Update the index-entity maps to point to the correct elements
-        int entityIdOfLastElement = indexToEntityId[indexOfLast];
-        entityIdToIndex[entityIdOfLastElement] = indexOfRemoved;
-        indexToEntityId[indexOfRemoved] = entityIdOfLastElement;
+        Emplace(entityId, std::move(object));
+    }
 
-        entityIdToIndex.erase(entityId);
-        indexToEntityId.erase(indexOfLast);
+    void Remove(int entityId)
+    {
+        // Move the last element to the delete position to keep the array packed
+        int& indexOfRemoved = GetSparseSlot(entityId);
+        const int indexOfLast = size - 1;
+        const int entityIdOfLastElement = entityIds[indexOfLast];
+        if (indexOfRemoved != indexOfLast)
+            data[indexOfRemoved] = std::move(data[indexOfLast]);
+        entityIds[indexOfRemoved] = entityIdOfLastElement;
+        changeTicks[indexOfRemoved] = changeTicks[indexOfLast];
+
+        // Point the moved entity to its new position and forget the removed one
+        GetSparseSlot(entityIdOfLastElement) = indexOfRemoved;
+        indexOfRemoved = INVALID_INDEX;
+        data.pop_back();
+        entityIds.pop_back();
+        changeTicks.pop_back();
 
         size--;
     }
 
     virtual void RemoveEntityFromPool(int entityId) override
     {
-        if (entityIdToIndex.find(entityId) != entityIdToIndex.end())
+        if (Has(entityId))
         {
             Remove(entityId);
         }
     }
-    
+
+    // The entity must have a component in this pool (check with Has() first).
     T& Get(int entityId)
     {
-        int index = entityIdToIndex[entityId];
-        return static_cast<T&>(data[index]);
+        return data[GetIndex(entityId)];
+    }
+
+    // Appends a copy of the prototype for every given entity, none of them may already be in the pool.
+    // All the copies are made in one pass, a straight copy loop for trivially copyable components.
+    void AppendCopies(const std::vector<Entity>& entities, const T& prototype, std::uint32_t tick)
+    {
+        const int count = static_cast<int>(entities.size());
+        data.insert(data.end(), count, prototype);
+        changeTicks.insert(changeTicks.end(), count, tick);
+        for (Entity entity : entities)
+        {
+            GetSparseSlot(entity.GetId()) = size++;
+            entityIds.push_back(entity.GetId());
+        }
+    }
+
+    // Packed components, in the same order as GetEntityIds()
+    const std::vector<T>& GetComponents() const { return data; }
+
+    // Replaces the whole content of the pool with the given packed entity ids and components
+    void Assign(std::vector<int> packedEntityIds, std::vector<T> components, std::uint32_t tick)
+    {
+        Clear();
+        size = static_cast<int>(packedEntityIds.size());
+        entityIds = std::move(packedEntityIds);
+        data = std::move(components);
+        changeTicks.assign(size, tick);
+        for (int index = 0; index < size; index++)
+        {
+            GetSparseSlot(entityIds[index]) = index;
+        }
+    }
+
+    // The entity must have a component in this pool.
+    void MarkChanged(int entityId, std::uint32_t tick) { changeTicks[GetIndex(entityId)] = tick; }
+    std::uint32_t GetChangeTick(int entityId) const { return changeTicks[GetIndex(entityId)]; }
+
+    // Returns the id of the entity that owns the element at the given packed index.
+    int GetEntityId(int index) const
+    {
+        return entityIds[index];
     }
 
     T& operator [](unsigned int index)
@@ -201,6 +351,265 @@ public:
     }
 };
 
+/**
+ * @name ComponentInfo
+ * @brief Type-erased description of a component type, so the archetype storage can move and destroy
+ * components that it only knows by their component id.
+ */
+struct ComponentInfo
+{
+    size_t size = 0;
+    size_t alignment = 0;
+    void (*moveConstruct)(void* destination, void* source) = nullptr;
+    void (*destroy)(void* component) = nullptr;
+
+    template <typename T> static ComponentInfo Create();
+};
+
+/**
+ * @name Archetype
+ * @brief An archetype stores all the entities that share the same signature. They live in fixed-size
+ * chunks, and each chunk holds one packed array per component type (structure of arrays), so a system
+ * can stream through the components it needs in contiguous memory.
+ */
+class Archetype
+{
+public:
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+    Archetype(const Signature& signature, const std::vector<ComponentInfo>& componentInfos);
+    Archetype(const Archetype&) = delete;
+    Archetype& operator =(const Archetype&) = delete;
+    ~Archetype();
+
+    const Signature& GetSignature() const { return signature; }
+    bool HasComponent(int componentId) const { return signature.test(componentId); }
+    int GetChunkCapacity() const { return chunkCapacity; }
+    int GetNumChunks() const { return static_cast<int>(chunks.size()); }
+    int GetNumEntities(int chunk) const { return chunks[chunk].count; }
+
+    // Returns the array of entities stored in a chunk
+    Entity* GetEntities(int chunk) const;
+
+    // Returns the packed array of a component type inside a chunk
+    void* GetColumn(int chunk, int componentId) const;
+    template <typename T> T* GetColumn(int chunk) const;
+
+    // Returns the component of the entity stored in the given chunk row
+    void* GetComponent(int chunk, int row, int componentId) const;
+
+    // Appends a row for the entity, leaving its components uninitialized. Returns the chunk and row used.
+    std::pair<int, int> AllocateRow(Entity entity);
+
+    // Destroys the components of a row and moves the last row of the archetype in its place.
+    // Returns the id of the entity that was moved into the row, or -1 if the removed row was the last one.
+    int RemoveRow(int chunk, int row);
+
+private:
+    // A chunk is allocated as an array of cache lines so every column starts properly aligned
+    struct alignas(64) CacheLine { std::byte bytes[64]; };
+
+    struct Chunk
+    {
+        std::unique_ptr<CacheLine[]> memory;
+        int count = 0;
+    };
+
+    struct Column
+    {
+        int componentId;
+        size_t offset;
+        ComponentInfo info;
+    };
+
+    Signature signature;
+    int chunkCapacity;
+    size_t chunkBytes;
+    std::vector<Column> columns;
+
+    // Byte offset of the column of each component type inside a chunk
+    // [Array index = component type id]
+    std::array<size_t, MAX_COMPONENTS> columnOffsets;
+    std::array<size_t, MAX_COMPONENTS> componentSizes;
+
+    std::vector<Chunk> chunks;
+
+    std::byte* GetChunkMemory(int chunk) const { return chunks[chunk].memory[0].bytes; }
+};
+
+/**
+ * @name ArchetypeStorage
+ * @brief Component storage that groups entities by signature into archetypes. Adding or removing a
+ * component moves the entity (and all its components) to the archetype of its new signature.
+ */
+class ArchetypeStorage
+{
+public:
+    template <typename TComponent, typename ...TArgs> void AddComponent(Entity entity, TArgs&& ...args);
+    template <typename TComponent> void RemoveComponent(Entity entity);
+    template <typename TComponent> TComponent& GetComponent(int entityId) const;
+
+    // Destroys all the components of an entity
+    void RemoveEntity(int entityId);
+
+    // Invokes the function with (Entity, TComponents&...) for every entity that has all the components,
+    // walking each matching archetype chunk by chunk.
+    template <typename ...TComponents, typename TFunction> void Each(TFunction&& function);
+
+    const std::vector<Archetype*>& GetArchetypes() const { return archetypeList; }
+
+private:
+    struct EntityLocation
+    {
+        Archetype* archetype = nullptr;
+        int chunk = 0;
+        int row = 0;
+    };
+
+    // [Vector index = component type id]
+    std::vector<ComponentInfo> componentInfos;
+
+    std::unordered_map<Signature, std::unique_ptr<Archetype>> archetypes;
+    std::vector<Archetype*> archetypeList;
+
+    // Where each entity lives. [Vector index = entity id]
+    std::vector<EntityLocation> entityLocations;
+
+    template <typename TComponent> void RegisterComponent(int componentId);
+    EntityLocation& GetLocation(int entityId);
+    Archetype& GetOrCreateArchetype(const Signature& signature);
+
+    // Moves the entity and the components it shares with the target archetype into it.
+    EntityLocation& MoveEntity(Entity entity, Archetype& target);
+
+    template <typename TFunction, typename ...TComponents>
+    static void EachRow(TFunction& function, int count, const Entity* entities, TComponents* ...columns);
+};
+
+template <typename ...TComponents> class EntityView;
+
+/**
+ * @name Prefab
+ * @brief A reusable set of component values (and groups). Registry::Instantiate() stamps out copies of it
+ * for many entities at once, appending to every component pool in a single batched pass instead of adding
+ * each component to each entity one by one.
+ * Example: Prefab bullet; bullet.AddComponent<SpriteComponent>("bullet-texture", 4, 4).Group("projectiles");
+ */
+class Prefab
+{
+private:
+    struct IPrefabComponent
+    {
+        virtual ~IPrefabComponent() = default;
+        virtual int GetComponentId() const = 0;
+
+        // Appends a copy of the component for every entity to its pool
+        virtual void AddToPool(Registry& registry, const std::vector<Entity>& entities) const = 0;
+
+        // Used instead when the registry stores its components in archetypes
+        virtual void AddToEntity(Registry& registry, Entity entity) const = 0;
+    };
+
+    template <typename TComponent> struct PrefabComponent;
+
+    std::vector<std::unique_ptr<IPrefabComponent>> components;
+    Signature signature;
+    GroupMask groups;
+
+public:
+    Prefab() = default;
+
+    // Stores the component built from the given arguments, replacing any component of the same type
+    template <typename TComponent, typename ...TArgs> Prefab& AddComponent(TArgs&& ...args);
+    Prefab& Group(const std::string& group);
+    Prefab& Group(GroupId group);
+
+    const Signature& GetSignature() const { return signature; }
+
+    friend class Registry;
+};
+
+/**
+ * @name CommandBuffer
+ * @brief Records structural changes (create, add/remove component, kill) to be applied by the registry
+ * at its next Update(). Commands are stored back to back in a reusable arena, so recording doesn't touch
+ * the registry nor allocate once the buffer is warm. Different buffers can be recorded from different
+ * threads at the same time, but a single buffer must only be used by one thread at a time.
+ * Entities created through the buffer are placeholders that can only be used with this buffer until
+ * it is played back.
+ */
+class CommandBuffer
+{
+private:
+    struct Command
+    {
+        Command* next = nullptr;
+        virtual ~Command() = default;
+        virtual void Execute(Registry& registry, CommandBuffer& buffer) = 0;
+    };
+
+    struct CreateEntityCommand;
+    struct KillEntityCommand;
+    template <typename TComponent> struct AddComponentCommand;
+    template <typename TComponent> struct RemoveComponentCommand;
+
+    static constexpr size_t ARENA_BLOCK_SIZE = 16 * 1024;
+
+    struct ArenaBlock
+    {
+        std::unique_ptr<std::max_align_t[]> memory;
+        size_t capacity;
+    };
+
+    // Blocks are kept between playbacks and refilled from the start
+    std::vector<ArenaBlock> arenaBlocks;
+    size_t currentBlock = 0;
+    size_t blockOffset = 0;
+
+    Command* firstCommand = nullptr;
+    Command* lastCommand = nullptr;
+
+    int numPlaceholders = 0;
+
+    // Real entities of the placeholders, filled while playing back. [Vector index = placeholder index]
+    std::vector<Entity> createdEntities;
+
+    void* Allocate(size_t size, size_t alignment);
+    template <typename TCommand, typename ...TArgs> void Record(TArgs&& ...args);
+
+    // Maps a placeholder to the entity created for it, real entities are returned untouched
+    Entity Resolve(Entity entity) const;
+
+public:
+    CommandBuffer() = default;
+    ~CommandBuffer();
+    CommandBuffer(const CommandBuffer&) = delete;
+    CommandBuffer& operator =(const CommandBuffer&) = delete;
+
+    bool IsEmpty() const { return firstCommand == nullptr; }
+
+    Entity CreateEntity();
+    void KillEntity(Entity entity);
+    template <typename TComponent, typename ...TArgs> void AddComponent(Entity entity, TArgs&& ...args);
+    template <typename TComponent> void RemoveComponent(Entity entity);
+
+    // Applies the recorded commands in order and empties the buffer
+    void Playback(Registry& registry);
+
+    // Drops the recorded commands without applying them
+    void Clear();
+};
+
+/**
+ * @brief Where the registry keeps component data. Pools store one sparse set per component type,
+ * archetypes group the components of entities with the same signature together in chunks.
+ */
+enum class StorageMode
+{
+    Pools,
+    Archetypes
+};
+
 /**
  * @name Registry
  * @brief The registry manages the creation and deestruction of entities, add systems,
@@ -211,6 +620,14 @@ class Registry
 private:
     int numEntities = 0;
 
+    // Incremented by every Update(), writes to pool components are stamped with the current value
+    std::uint32_t changeTick = 1;
+
+    StorageMode storageMode;
+
+    // Component storage used instead of the pools when the registry runs in StorageMode::Archetypes
+    ArchetypeStorage archetypeStorage;
+
     // Vector of component pools, each pool contains all the data for a certain component type.
     // [Vector index = component type id], [Pool index = entity id]
     std::vector<std::shared_ptr<IPool>> componentPools;
@@ -222,40 +639,107 @@ private:
     // std::type_index is the index given to a class by the compiler.
     std::unordered_map<std::type_index, std::shared_ptr<System>> systems;
 
-    // Set of entities that are flagged to added or removed in the next registry Update()
-    std::set<Entity> entitiesToBeAdded;
-    std::set<Entity> entitiesToBeKilled;
+    // Cache of the systems interested in each component signature seen so far, so placing an entity
+    // costs one lookup instead of testing every system. Cleared whenever a system is added or removed.
+    std::unordered_map<Signature, std::vector<System*>> systemsPerSignature;
+
+    // Entities that are flagged to added or removed in the next registry Update()
+    std::vector<Entity> entitiesToBeAdded;
+    std::vector<Entity> entitiesToBeKilled;
+
+    // Entities already in their systems whose component signature changed, their membership
+    // is re-evaluated in the next registry Update()
+    std::vector<Entity> entitiesToBeRefreshed;
 
-    // Entity tags (one tag name per entity)
-    std::unordered_map<std::string, Entity> entityPerTag;
-    std::unordered_map<int, std::string> tagPerEntity;
+    // Component signature each entity had when its system membership was last evaluated,
+    // which tells the systems it currently belongs to. [Vector index = entity id]
+    std::vector<Signature> entitySystemSignatures;
 
-    // Entity groups (a set of entities per group name)
-    std::unordered_map<std::string, std::set<Entity>> entitiesPerGroup;
-    std::unordered_map<int, std::string> groupPerEntity;
+    // Whether the entity already waits in entitiesToBeAdded or entitiesToBeRefreshed. [Vector index = entity id]
+    std::vector<bool> isEntityPending;
+
+    // Command buffers handed out since the last Update(), played back in the order they were created.
+    // Played back buffers are kept in the free list to be handed out again.
+    std::vector<std::unique_ptr<CommandBuffer>> pendingCommandBuffers;
+    std::vector<std::unique_ptr<CommandBuffer>> freeCommandBuffers;
+    std::mutex commandBufferMutex;
+
+    // Entity tags (one tag per entity and one entity per tag)
+    // [tagPerEntity index = entity id, -1 when untagged], [entityPerTag index = tag id, -1 when unused]
+    std::vector<TagId> tagPerEntity;
+    std::vector<int> entityPerTag;
+
+    // Entity groups, a bit is turned "on" for every group the entity belongs to
+    // [Vector index = entity id]
+    std::vector<GroupMask> groupsPerEntity;
+
+    // Interned tag and group names, shared by every registry so the ids can be cached by systems
+    static std::unordered_map<std::string, TagId> tagIds;
+    static std::unordered_map<std::string, GroupId> groupIds;
+
+    // Current generation of every entity slot, bumped when the slot is freed.
+    // [Vector index = entity id]
+    std::vector<std::uint32_t> entityGenerations;
 
     // List of free entity ids that were previously removed
     std::deque<int> freeIds;
+
+    // Returns the pool of the given component type, creating it the first time it is needed
+    template <typename TComponent> Pool<TComponent>* GetOrCreatePool();
+
+    // Entities are created here then handed to the prefab components for the batched pool appends
+    template <typename TComponent> friend struct Prefab::PrefabComponent;
+
+    // Snapshots read and rebuild the whole registry state in one pass
+    friend class Snapshot;
+
+    // Returns the systems whose required components are all part of the given signature
+    const std::vector<System*>& GetSystemsMatching(const Signature& signature);
+
+    // Queues the entity for a membership refresh after one of its components was added or removed
+    void OnSignatureChanged(Entity entity);
+
+    // Moves the entity in or out of the systems affected by its signature change
+    void RefreshEntityInSystems(Entity entity);
     
 public:
-    Registry() { Logger::Log("Registry constructor."); }
-    ~Registry() { Logger::Log("Registry destructor."); }
+    Registry(StorageMode storageMode = StorageMode::Pools);
+    ~Registry();
+
+    StorageMode GetStorageMode() const { return storageMode; }
+    ArchetypeStorage& GetArchetypeStorage() { return archetypeStorage; }
     
     void Update();
 
     // Entity management
     Entity CreateEntity();
     void KillEntity(Entity entity);
+    bool IsAlive(Entity entity) const;
+
+    // Entities created and not killed yet. Killed entities are only removed by the next Update().
+    int GetNumEntities() const { return numEntities - static_cast<int>(freeIds.size()); }
+
+    // Returns an empty command buffer that will be played back at the next Update().
+    // Safe to call from several threads, the buffer stays valid until that Update().
+    CommandBuffer& CreateCommandBuffer();
 
-    // Tag management
+    // Returns the id of a tag or group name, registering the name the first time it is seen
+    static TagId GetTagId(const std::string& tag);
+    static GroupId GetGroupId(const std::string& group);
+
+    // Tag management (tagging an entity replaces its previous tag and takes the tag from any other entity)
     void TagEntity(Entity entity, const std::string& tag);
+    void TagEntity(Entity entity, TagId tag);
     bool EntityHasTag(Entity entity, const std::string& tag) const;
+    bool EntityHasTag(Entity entity, TagId tag) const;
     Entity GetEntityByTag(const std::string& tag) const;
     void RemoveEntityTag(Entity entity);
 
-    // Group management
+    // Group management (an entity can belong to several groups)
     void GroupEntity(Entity entity, const std::string& group);
+    void GroupEntity(Entity entity, GroupId group);
     bool EntityBelongsToGroup(Entity entity, const std::string& group) const;
+    bool EntityBelongsToGroup(Entity entity, GroupId group) const;
     std::vector<Entity> GetEntitiesByGroup(const std::string& group) const;
     void RemoveEntityGroup(Entity entity);
 
@@ -265,14 +749,87 @@ public:
     template <typename TComponent> bool HasComponent(Entity entity) const;
     template <typename TComponent> TComponent& GetComponent(Entity entity) const;
 
+    // Change tracking: adding a component, GetComponent() and iterating it as non-const in a view
+    // flag it as changed at the current tick, GetComponent<const T>() only reads. MarkDirty() flags it
+    // explicitly, e.g. after writing through a reference kept from an earlier access.
+    // Archetype storage does not track changes, there every component always counts as changed.
+    std::uint32_t GetChangeTick() const { return changeTick; }
+    template <typename TComponent> void MarkDirty(Entity entity);
+
+    // Pre-allocates room for n components of the given type, so adding them does not regrow the pool
+    template <typename TComponent> void Reserve(int n);
+
+    // Creates count entities with a copy of every component and group of the prefab. The function is
+    // then called as function(Entity, int index) for each new entity, to override per-instance values
+    // such as positions.
+    template <typename TFunction> void Instantiate(const Prefab& prefab, int count, TFunction&& function);
+    void Instantiate(const Prefab& prefab, int count);
+    Entity Instantiate(const Prefab& prefab);
+
+    // Returns a view over every entity that has all the given components. Components requested as const
+    // are read-only and are not flagged as changed.
+    // Example: registry->View<TransformComponent, const RigidBodyComponent>().Each([](Entity entity, auto& transform, auto& rigidBody) { ... });
+    template <typename ...TComponents> EntityView<TComponents...> View();
+
     template <typename TSystem, typename ...TArgs> void AddSystem(TArgs&& ...args);
     template <typename TSystem> void RemoveSystem();
     template <typename TSystem> bool HasSystem() const;
     template <typename TSystem> TSystem& GetSystem() const;
 
-    // Add and remove entities from systems.
+    // Add and remove entities from systems. Adding or removing components of an entity that is already
+    // in its systems updates its membership at the next Update(), until then the systems still see it.
     void AddEntityToSystems(Entity entity);
     void RemoveEntityFromSystems(Entity entity);
+
+    template <typename ...TComponents> friend class EntityView;
+};
+
+/**
+ * @name EntityView
+ * @brief Iterates the entities that have all of TComponents and hands out references to their components.
+ * The component pools are resolved once when the view is created, and Each() walks the smallest of them.
+ * Killing or creating entities while iterating is fine, but components of the viewed types must not be
+ * added or removed until the iteration is over.
+ * Non-const components are flagged as changed for every visited entity, const ones are only read.
+ */
+template <typename ...TComponents>
+class EntityView
+{
+public:
+    EntityView(Registry& registry);
+
+    // Only visit the entities whose TComponent changed at or after the given registry tick
+    // (pass the Registry::GetChangeTick() value saved at the end of the previous run).
+    template <typename TComponent> EntityView& Changed(std::uint32_t sinceTick);
+
+    // Invokes function(Entity, TComponents&...) for every entity that has all the components
+    template <typename TFunction> void Each(TFunction&& function) const;
+
+    // Same as above, but walks the given entities (e.g. a system list) in their order instead of a pool.
+    // Every entity in the list must have all the components.
+    template <typename TFunction> void Each(const std::vector<Entity>& entities, TFunction&& function) const;
+
+    // Each() walks the dense range [0, GetRangeSize()) of the smallest pool. Each(begin, end, function)
+    // only walks part of it, so the range can be split in batches run on different threads
+    // (e.g. with JobSystem::ParallelFor). Archetype storage is walked as a single range of size 1.
+    int GetRangeSize() const;
+    template <typename TFunction> void Each(int begin, int end, TFunction&& function) const;
+
+private:
+    template <typename TComponent> using PoolOf = Pool<std::remove_const_t<TComponent>>;
+
+    Registry& registry;
+    Signature signature;
+    std::tuple<PoolOf<TComponents>*...> pools;
+
+    Signature changedFilter;
+    std::uint32_t changedSinceTick = 0;
+
+    template <typename TComponent> PoolOf<TComponent>* GetPool() const { return std::get<PoolOf<TComponent>*>(pools); }
+    const IPool* GetSmallestPool() const;
+    template <typename TComponent> TComponent& Get(Entity entity) const;
+    template <typename TComponent> bool PassesChangedFilter(int entityId) const;
+    template <typename TComponent> void MarkIfMutable(int entityId) const;
 };
 
 /* Template function implementations. */
@@ -284,13 +841,150 @@ void System::RequireComponent()
     componentSignature.set(componentId);
 }
 
+template <typename TComponent>
+void System::ReadsComponent()
+{
+    readSignature.set(Component<TComponent>::GetId());
+    hasDeclaredAccess = true;
+}
+
+template <typename TComponent>
+void System::WritesComponent()
+{
+    writeSignature.set(Component<TComponent>::GetId());
+    hasDeclaredAccess = true;
+}
+
+template <typename T>
+ComponentInfo ComponentInfo::Create()
+{
+    ComponentInfo info;
+    info.size = sizeof(T);
+    info.alignment = alignof(T);
+    info.moveConstruct = [](void* destination, void* source) { new (destination) T(std::move(*static_cast<T*>(source))); };
+    info.destroy = [](void* component) { static_cast<T*>(component)->~T(); };
+    return info;
+}
+
+template <typename T>
+T* Archetype::GetColumn(int chunk) const
+{
+    return static_cast<T*>(GetColumn(chunk, Component<T>::GetId()));
+}
+
+template <typename TComponent>
+void ArchetypeStorage::RegisterComponent(int componentId)
+{
+    if (componentId >= static_cast<int>(componentInfos.size()))
+        componentInfos.resize(componentId + 1);
+
+    if (!componentInfos[componentId].size)
+        componentInfos[componentId] = ComponentInfo::Create<TComponent>();
+}
+
+template <typename TComponent, typename ...TArgs>
+void ArchetypeStorage::AddComponent(Entity entity, TArgs&& ...args)
+{
+    const auto componentId = Component<TComponent>::GetId();
+    RegisterComponent<TComponent>(componentId);
+
+    EntityLocation& location = GetLocation(entity.GetId());
+    if (location.archetype && location.archetype->HasComponent(componentId))
+    {
+        // If the component already exists, simply replace the component object
+        auto* component = static_cast<TComponent*>(location.archetype->GetComponent(location.chunk, location.row, componentId));
+        *component = TComponent(std::forward<TArgs>(args)...);
+        return;
+    }
+
+    Signature signature = location.archetype ? location.archetype->GetSignature() : Signature();
+    signature.set(componentId);
+
+    // Move the entity to the archetype of its new signature, then build the new component in place
+    EntityLocation& newLocation = MoveEntity(entity, GetOrCreateArchetype(signature));
+    new (newLocation.archetype->GetComponent(newLocation.chunk, newLocation.row, componentId)) TComponent(std::forward<TArgs>(args)...);
+}
+
+template <typename TComponent>
+void ArchetypeStorage::RemoveComponent(Entity entity)
+{
+    const auto componentId = Component<TComponent>::GetId();
+
+    EntityLocation& location = GetLocation(entity.GetId());
+    if (!location.archetype || !location.archetype->HasComponent(componentId))
+        return;
+
+    Signature signature = location.archetype->GetSignature();
+    signature.set(componentId, false);
+    MoveEntity(entity, GetOrCreateArchetype(signature));
+}
+
+template <typename TComponent>
+TComponent& ArchetypeStorage::GetComponent(int entityId) const
+{
+    const EntityLocation& location = entityLocations[entityId];
+    return *static_cast<TComponent*>(location.archetype->GetComponent(location.chunk, location.row, Component<TComponent>::GetId()));
+}
+
+template <typename ...TComponents, typename TFunction>
+void ArchetypeStorage::Each(TFunction&& function)
+{
+    Signature required;
+    (required.set(Component<TComponents>::GetId()), ...);
+
+    for (auto archetype : archetypeList)
+    {
+        if ((archetype->GetSignature() & required) != required)
+            continue;
+
+        // Resolve the columns once per chunk and stream through them
+        for (int chunk = 0; chunk < archetype->GetNumChunks(); chunk++)
+        {
+            EachRow(function, archetype->GetNumEntities(chunk), archetype->GetEntities(chunk), archetype->GetColumn<TComponents>(chunk)...);
+        }
+    }
+}
+
+template <typename TFunction, typename ...TComponents>
+void ArchetypeStorage::EachRow(TFunction& function, int count, const Entity* entities, TComponents* ...columns)
+{
+    for (int i = 0; i < count; i++)
+    {
+        function(entities[i], columns[i]...);
+    }
+}
+
 template <typename TComponent, typename... TArgs>
 void Registry::AddComponent(Entity entity, TArgs&&... args)
 {
     const auto componentId = Component<TComponent>::GetId();
     const auto entityId = entity.GetId();
 
-    if (componentId >= componentPools.size())
+    if (storageMode == StorageMode::Archetypes)
+    {
+        archetypeStorage.AddComponent<TComponent>(entity, std::forward<TArgs>(args)...);
+    }
+    else
+    {
+        // Build the component directly inside the pool, without any temporary copy
+        auto componentPool = GetOrCreatePool<TComponent>();
+        componentPool->Emplace(entityId, std::forward<TArgs>(args)...);
+        componentPool->MarkChanged(entityId, changeTick);
+    }
+
+    if (!entityComponentSignatures[entityId].test(componentId))
+    {
+        entityComponentSignatures[entityId].set(componentId);
+        OnSignatureChanged(entity);
+    }
+}
+
+template <typename TComponent>
+Pool<TComponent>* Registry::GetOrCreatePool()
+{
+    const auto componentId = Component<TComponent>::GetId();
+
+    if (static_cast<std::size_t>(componentId) >= componentPools.size())
         componentPools.resize(componentId + 1, nullptr);
 
     if (!componentPools[componentId])
@@ -299,12 +993,17 @@ void Registry::AddComponent(Entity entity, TArgs&&... args)
         componentPools[componentId] = newComponentPool;
     }
 
-    std::shared_ptr<Pool<TComponent>> componentPool = std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId]);
-    
-    TComponent newComponent(std::forward<TArgs>(args)...);
+    return static_cast<Pool<TComponent>*>(componentPools[componentId].get());
+}
 
-    componentPool->Set(entityId, newComponent);
-    entityComponentSignatures[entityId].set(componentId);
+template <typename TComponent>
+void Registry::Reserve(int n)
+{
+    // Archetype chunks are sized per component combination, so there is nothing to pre-allocate per type
+    if (storageMode == StorageMode::Archetypes)
+        return;
+
+    GetOrCreatePool<TComponent>()->Reserve(n);
 }
 
 template <typename TComponent>
@@ -313,12 +1012,23 @@ void Registry::RemoveComponent(Entity entity)
     const auto entityId = entity.GetId();
     const auto componentId = Component<TComponent>::GetId();
 
+    if (!HasComponent<TComponent>(entity))
+        return;
+
     // Remove the component from the component list for that entity
-    std::shared_ptr<Pool<TComponent>> componentPool = std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId]);
-    componentPool->Remove(entityId);
+    if (storageMode == StorageMode::Archetypes)
+    {
+        archetypeStorage.RemoveComponent<TComponent>(entity);
+    }
+    else
+    {
+        std::shared_ptr<Pool<TComponent>> componentPool = std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId]);
+        componentPool->Remove(entityId);
+    }
 
     // Update the component signature for that entity
     entityComponentSignatures[entityId].set(componentId, false);
+    OnSignatureChanged(entity);
 }
 
 template <typename TComponent>
@@ -333,24 +1043,332 @@ bool Registry::HasComponent(Entity entity) const
 template <typename TComponent>
 TComponent& Registry::GetComponent(Entity entity) const
 {
+    using TStored = std::remove_const_t<TComponent>;
     const auto entityId = entity.GetId();
-    const auto componentId = Component<TComponent>::GetId();
-    auto componentPool = std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId]);
+    const auto componentId = Component<TStored>::GetId();
+
+    if (storageMode == StorageMode::Archetypes)
+        return archetypeStorage.GetComponent<TStored>(entityId);
+
+    // Handing out a mutable reference counts as a write
+    auto componentPool = static_cast<Pool<TStored>*>(componentPools[componentId].get());
+    if constexpr (!std::is_const_v<TComponent>)
+        componentPool->MarkChanged(entityId, changeTick);
     return componentPool->Get(entityId);
 }
 
+template <typename TComponent>
+void Registry::MarkDirty(Entity entity)
+{
+    if (storageMode == StorageMode::Archetypes || !HasComponent<TComponent>(entity))
+        return;
+
+    auto componentPool = static_cast<Pool<TComponent>*>(componentPools[Component<TComponent>::GetId()].get());
+    componentPool->MarkChanged(entity.GetId(), changeTick);
+}
+
+template <typename ...TComponents>
+EntityView<TComponents...> Registry::View()
+{
+    return EntityView<TComponents...>(*this);
+}
+
+template <typename ...TComponents>
+EntityView<TComponents...>::EntityView(Registry& registry) : registry(registry)
+{
+    (signature.set(Component<std::remove_const_t<TComponents>>::GetId()), ...);
+
+    // A pool that was never created stays null, which means no entity can match the view
+    auto findPool = [&registry](int componentId) -> IPool* {
+        return componentId < static_cast<int>(registry.componentPools.size()) ? registry.componentPools[componentId].get() : nullptr;
+    };
+    pools = std::make_tuple(static_cast<PoolOf<TComponents>*>(findPool(Component<std::remove_const_t<TComponents>>::GetId()))...);
+}
+
+template <typename ...TComponents>
+template <typename TComponent>
+EntityView<TComponents...>& EntityView<TComponents...>::Changed(std::uint32_t sinceTick)
+{
+    static_assert((std::is_same_v<TComponent, std::remove_const_t<TComponents>> || ...), "Changed<T>() needs T to be part of the view");
+
+    changedFilter.set(Component<TComponent>::GetId());
+    changedSinceTick = sinceTick;
+    return *this;
+}
+
+template <typename ...TComponents>
+template <typename TComponent>
+TComponent& EntityView<TComponents...>::Get(Entity entity) const
+{
+    if (registry.storageMode == StorageMode::Archetypes)
+        return registry.archetypeStorage.template GetComponent<std::remove_const_t<TComponent>>(entity.GetId());
+    return GetPool<TComponent>()->Get(entity.GetId());
+}
+
+template <typename ...TComponents>
+template <typename TComponent>
+bool EntityView<TComponents...>::PassesChangedFilter(int entityId) const
+{
+    return !changedFilter.test(Component<std::remove_const_t<TComponent>>::GetId())
+        || GetPool<TComponent>()->GetChangeTick(entityId) >= changedSinceTick;
+}
+
+template <typename ...TComponents>
+template <typename TComponent>
+void EntityView<TComponents...>::MarkIfMutable(int entityId) const
+{
+    if constexpr (!std::is_const_v<TComponent>)
+        GetPool<TComponent>()->MarkChanged(entityId, registry.changeTick);
+}
+
+template <typename ...TComponents>
+const IPool* EntityView<TComponents...>::GetSmallestPool() const
+{
+    if (!(GetPool<TComponents>() && ...))
+        return nullptr;
+
+    const IPool* smallestPool = nullptr;
+    ((smallestPool = (!smallestPool || GetPool<TComponents>()->GetSize() < smallestPool->GetSize()) ? GetPool<TComponents>() : smallestPool), ...);
+    return smallestPool;
+}
+
+template <typename ...TComponents>
+int EntityView<TComponents...>::GetRangeSize() const
+{
+    if (registry.storageMode == StorageMode::Archetypes)
+        return 1;
+
+    const IPool* smallestPool = GetSmallestPool();
+    return smallestPool ? smallestPool->GetSize() : 0;
+}
+
+template <typename ...TComponents>
+template <typename TFunction>
+void EntityView<TComponents...>::Each(TFunction&& function) const
+{
+    Each(0, GetRangeSize(), std::forward<TFunction>(function));
+}
+
+template <typename ...TComponents>
+template <typename TFunction>
+void EntityView<TComponents...>::Each(int begin, int end, TFunction&& function) const
+{
+    if (registry.storageMode == StorageMode::Archetypes)
+    {
+        if (begin == 0 && end > 0)
+            registry.archetypeStorage.template Each<std::remove_const_t<TComponents>...>(function);
+        return;
+    }
+
+    const IPool* smallestPool = GetSmallestPool();
+    if (!smallestPool)
+        return;
+
+    // Walk the packed entity ids of the smallest pool, and skip the entities missing any other component
+    const auto& signatures = registry.entityComponentSignatures;
+    const auto& generations = registry.entityGenerations;
+    const auto& entityIds = smallestPool->GetEntityIds();
+    end = std::min(end, static_cast<int>(entityIds.size()));
+    for (int i = begin; i < end; i++)
+    {
+        const int entityId = entityIds[i];
+        if ((signatures[entityId] & signature) != signature)
+            continue;
+        if (changedFilter.any() && !(PassesChangedFilter<TComponents>(entityId) && ...))
+            continue;
+        (MarkIfMutable<TComponents>(entityId), ...);
+        function(Entity(entityId, generations[entityId]), static_cast<TComponents&>(GetPool<TComponents>()->Get(entityId))...);
+    }
+}
+
+template <typename ...TComponents>
+template <typename TFunction>
+void EntityView<TComponents...>::Each(const std::vector<Entity>& entities, TFunction&& function) const
+{
+    if (registry.storageMode == StorageMode::Archetypes)
+    {
+        for (auto entity : entities)
+            function(entity, Get<TComponents>(entity)...);
+        return;
+    }
+
+    for (auto entity : entities)
+    {
+        const auto entityId = entity.GetId();
+        if (changedFilter.any() && !(PassesChangedFilter<TComponents>(entityId) && ...))
+            continue;
+        (MarkIfMutable<TComponents>(entityId), ...);
+        function(entity, Get<TComponents>(entity)...);
+    }
+}
+
+template <typename TComponent>
+struct Prefab::PrefabComponent : IPrefabComponent
+{
+    TComponent prototype;
+
+    template <typename ...TArgs>
+    PrefabComponent(TArgs&& ...args) : prototype(std::forward<TArgs>(args)...) {}
+
+    int GetComponentId() const override { return Component<TComponent>::GetId(); }
+
+    void AddToPool(Registry& registry, const std::vector<Entity>& entities) const override
+    {
+        registry.GetOrCreatePool<TComponent>()->AppendCopies(entities, prototype, registry.changeTick);
+    }
+
+    void AddToEntity(Registry& registry, Entity entity) const override
+    {
+        registry.AddComponent<TComponent>(entity, prototype);
+    }
+};
+
+template <typename TComponent, typename ...TArgs>
+Prefab& Prefab::AddComponent(TArgs&& ...args)
+{
+    const auto componentId = Component<TComponent>::GetId();
+    auto component = std::make_unique<PrefabComponent<TComponent>>(std::forward<TArgs>(args)...);
+
+    if (signature.test(componentId))
+    {
+        for (auto& existingComponent : components)
+        {
+            if (existingComponent->GetComponentId() == componentId)
+                existingComponent = std::move(component);
+        }
+        return *this;
+    }
+
+    components.push_back(std::move(component));
+    signature.set(componentId);
+    return *this;
+}
+
+template <typename TFunction>
+void Registry::Instantiate(const Prefab& prefab, int count, TFunction&& function)
+{
+    // Create every entity first, so each component type can then be appended to its pool at once
+    std::vector<Entity> entities;
+    entities.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+        entities.push_back(CreateEntity());
+    }
+
+    if (storageMode == StorageMode::Archetypes)
+    {
+        for (auto entity : entities)
+        {
+            for (const auto& component : prefab.components)
+                component->AddToEntity(*this, entity);
+        }
+    }
+    else
+    {
+        for (const auto& component : prefab.components)
+            component->AddToPool(*this, entities);
+
+        // The new entities wait in entitiesToBeAdded, so they join their systems with this signature
+        for (auto entity : entities)
+            entityComponentSignatures[entity.GetId()] = prefab.signature;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        groupsPerEntity[entities[i].GetId()] = prefab.groups;
+        function(entities[i], i);
+    }
+}
+
+struct CommandBuffer::CreateEntityCommand : Command
+{
+    void Execute(Registry& registry, CommandBuffer& buffer) override
+    {
+        buffer.createdEntities.push_back(registry.CreateEntity());
+    }
+};
+
+struct CommandBuffer::KillEntityCommand : Command
+{
+    Entity entity;
+
+    KillEntityCommand(Entity entity) : entity(entity) {}
+
+    void Execute(Registry& registry, CommandBuffer& buffer) override
+    {
+        registry.KillEntity(buffer.Resolve(entity));
+    }
+};
+
+template <typename TComponent>
+struct CommandBuffer::AddComponentCommand : Command
+{
+    Entity entity;
+    TComponent component;
+
+    template <typename ...TArgs>
+    AddComponentCommand(Entity entity, TArgs&& ...args) : entity(entity), component(std::forward<TArgs>(args)...) {}
+
+    void Execute(Registry& registry, CommandBuffer& buffer) override
+    {
+        registry.AddComponent<TComponent>(buffer.Resolve(entity), std::move(component));
+    }
+};
+
+template <typename TComponent>
+struct CommandBuffer::RemoveComponentCommand : Command
+{
+    Entity entity;
+
+    RemoveComponentCommand(Entity entity) : entity(entity) {}
+
+    void Execute(Registry& registry, CommandBuffer& buffer) override
+    {
+        registry.RemoveComponent<TComponent>(buffer.Resolve(entity));
+    }
+};
+
+template <typename TCommand, typename ...TArgs>
+void CommandBuffer::Record(TArgs&& ...args)
+{
+    static_assert(alignof(TCommand) <= alignof(std::max_align_t), "Over-aligned commands are not supported");
+
+    TCommand* command = new (Allocate(sizeof(TCommand), alignof(TCommand))) TCommand(std::forward<TArgs>(args)...);
+    if (lastCommand)
+        lastCommand->next = command;
+    else
+        firstCommand = command;
+    lastCommand = command;
+}
+
+template <typename TComponent, typename ...TArgs>
+void CommandBuffer::AddComponent(Entity entity, TArgs&& ...args)
+{
+    Record<AddComponentCommand<TComponent>>(entity, std::forward<TArgs>(args)...);
+}
+
+template <typename TComponent>
+void CommandBuffer::RemoveComponent(Entity entity)
+{
+    Record<RemoveComponentCommand<TComponent>>(entity);
+}
+
 template <typename TSystem, typename... TArgs>
 void Registry::AddSystem(TArgs&&... args)
 {
     std::shared_ptr<TSystem> newSystem = std::make_shared<TSystem>(std::forward<TArgs>(args)...);
     systems.insert(std::make_pair(std::type_index(typeid(TSystem)), newSystem));
+    systemsPerSignature.clear();
 }
 
 template <typename TSystem>
 void Registry::RemoveSystem()
 {
     auto system = systems.find(std::type_index(typeid(TSystem)));
+    if (system == systems.end())
+        return;
     systems.erase(system);
+    systemsPerSignature.clear();
 }
 
 template <typename TSystem>
@@ -4,4 +4,23 @@ class Event
 {
 public:
     Event() = default;
-};
\ No newline at end of file
+};
+
+struct IEventType
+{
+protected:
+    inline static int nextId = 0;
+};
+
+// Used to assign a unique id to an event type, the EventBus indexes its handlers with it
+template <typename TEvent>
+class EventType : public IEventType
+{
+public:
+    // Returns the unique id of EventType<TEvent>
+    static int GetId()
+    {
+        static auto id = nextId++;
+        return id;
+    }
+};
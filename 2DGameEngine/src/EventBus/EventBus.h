@@ -1,57 +1,148 @@
 #pragma once
 
-#include <typeindex>
+#include <algorithm>
+#include <cstdint>
 #include <memory>
-#include <list>
-#include <map>
+#include <numeric>
+#include <vector>
 
 #include "Event.h"
 #include "../Logger/Logger.h"
 
-class IEventCallback
+// Owner and event types of a member function used as an event callback
+template <typename TCallback>
+struct EventCallbackTraits;
+
+template <typename TOwner, typename TEvent>
+struct EventCallbackTraits<void (TOwner::*)(TEvent&)>
+{
+    typedef TOwner Owner;
+    typedef TEvent Event;
+};
+
+template <typename TOwner, typename TEvent>
+struct EventCallbackTraits<void (TOwner::*)(const TEvent&)>
+{
+    typedef TOwner Owner;
+    typedef TEvent Event;
+};
+
+/**
+ * @name EventDelegate
+ * @brief A subscribed callback: the object and a plain function that calls the member function on it.
+ * Delegates are stored by value in one array per event type, so emitting never touches the heap.
+ */
+struct EventDelegate
+{
+    // Null once unsubscribed during an emit, the delegate is removed when the emit returns
+    void* owner;
+    void (*function)(void* owner, Event& event);
+    std::uint64_t subscriptionId;
+};
+
+class IEventQueue
 {
-private:
-    virtual void Call(Event& e) = 0;
-    
 public:
-    virtual ~IEventCallback() = default;
+    virtual ~IEventQueue() = default;
+    virtual void Clear() = 0;
+};
 
-    void Execute(Event& e)
+/**
+ * @name EventQueue
+ * @brief Events of one type queued by EventBus::QueueEvent, stored contiguously in the order they were queued.
+ * Nothing is called when an event is queued, every consumer reads the whole queue in its own update instead.
+ * The queues are cleared after every simulation step, so the consumers must run after the producers.
+ */
+template <typename TEvent>
+class EventQueue : public IEventQueue
+{
+public:
+    template <typename ...TArgs>
+    void Push(TArgs&& ...args)
     {
-        Call(e);
+        events.emplace_back(std::forward<TArgs>(args)...);
     }
+
+    const std::vector<TEvent>& GetEvents() const { return events; }
+    int GetSize() const { return static_cast<int>(events.size()); }
+    bool IsEmpty() const { return events.empty(); }
+
+    // Fills order with the indices of the events sorted by key (e.g. an entity id), for a consumer that wants
+    // them grouped. The consumer owns the buffer and the queue is never reordered, so consumers running at the
+    // same time each get their own order. Events with the same key keep their order.
+    template <typename TKey>
+    void GetSortedOrder(TKey key, std::vector<int>& order) const
+    {
+        order.resize(events.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return key(events[a]) < key(events[b]);
+        });
+    }
+
+    // Keeps the capacity, queueing the next events doesn't allocate
+    void Clear() override
+    {
+        events.clear();
+    }
+
+private:
+    std::vector<TEvent> events;
 };
 
-template <typename TOwner, typename TEvent>
-class EventCallback : public IEventCallback
+class EventBus;
+
+/**
+ * @name EventSubscription
+ * @brief Handle returned by EventBus::SubscribeToEvent. The callback stays subscribed until Unsubscribe() is
+ * called or the handle is destroyed, so a system that keeps its handles as members is unsubscribed with it.
+ * Handles can be moved but not copied, and may outlive the event bus.
+ */
+class EventSubscription
 {
-    typedef void (TOwner::*CallbackFunction)(TEvent&);
 public:
-    EventCallback(TOwner* ownerInstance, CallbackFunction callbackFunction)
+    EventSubscription() = default;
+    EventSubscription(std::weak_ptr<EventBus*> eventBus, int eventTypeId, std::uint64_t id)
+        : eventBus(std::move(eventBus)), eventTypeId(eventTypeId), id(id) {}
+
+    ~EventSubscription() { Unsubscribe(); }
+
+    EventSubscription(const EventSubscription&) = delete;
+    EventSubscription& operator =(const EventSubscription&) = delete;
+
+    EventSubscription(EventSubscription&& other) noexcept
+        : eventBus(std::move(other.eventBus)), eventTypeId(other.eventTypeId), id(other.id)
     {
-        this->ownerInstance = ownerInstance;
-        this->callbackFunction = callbackFunction;
+        other.id = 0;
     }
 
-    virtual ~EventCallback() override = default;
-    
-private:
-
-    TOwner* ownerInstance;
-    CallbackFunction callbackFunction;
-    
-    virtual void Call(Event& e) override
+    EventSubscription& operator =(EventSubscription&& other) noexcept
     {
-        std::invoke(callbackFunction, ownerInstance, static_cast<TEvent&>(e));
+        if (this != &other)
+        {
+            Unsubscribe();
+            eventBus = std::move(other.eventBus);
+            eventTypeId = other.eventTypeId;
+            id = other.id;
+            other.id = 0;
+        }
+        return *this;
     }
-};
 
-typedef std::list<std::unique_ptr<IEventCallback>> HandlerList;
+    bool IsSubscribed() const { return id != 0 && !eventBus.expired(); }
+
+    void Unsubscribe();
+
+private:
+    std::weak_ptr<EventBus*> eventBus;
+    int eventTypeId = 0;
+    std::uint64_t id = 0;
+};
 
 class EventBus
 {
 public:
-    EventBus()
+    EventBus() : self(std::make_shared<EventBus*>(this))
     {
         Logger::Log("EventBus constructor");
     }
@@ -61,49 +152,168 @@ public:
         Logger::Log("EventBus destructor");
     }
 
-    // Clear the subscriber list
+    // Subscriptions point back to the bus, it cannot move
+    EventBus(const EventBus&) = delete;
+    EventBus& operator =(const EventBus&) = delete;
+
+    // Clear the subscriber list and the queued events. The existing subscriptions become no-ops.
     void Reset()
     {
-        subscribers.clear();
+        delegates.clear();
+        ClearQueuedEvents();
     }
     
     /**
      * @name Subscribe To event of type <T>
-     * @brief In our implementation, a listener subscribes to an event \n
-     * Example: eventBus->SubscribeToEvent<CollisionEvent>(this, &Game::OnCollision)
+     * @brief In our implementation, a listener subscribes to an event once and keeps the returned handle,
+     * the callback is unsubscribed when the handle is destroyed. The event type is the parameter of the callback. \n
+     * Example: collisionSubscription = eventBus->SubscribeToEvent<&Game::OnCollision>(this)
      */
-    template <typename TEvent, typename TOwner>
-    void SubscribeToEvent(TOwner* ownerInstance, void (TOwner::*callbackFunction)(TEvent& event))
+    template <auto Callback>
+    [[nodiscard]] EventSubscription SubscribeToEvent(typename EventCallbackTraits<decltype(Callback)>::Owner* ownerInstance)
     {
-        if (!subscribers[typeid(TEvent)].get())
-        {
-            // Create Handler List for the type TEvent if it doesn't exist.
-            subscribers[typeid(TEvent)] = std::make_unique<HandlerList>();
-        }
-        auto subscriber = std::make_unique<EventCallback<TOwner, TEvent>>(ownerInstance, callbackFunction);
-        subscribers[typeid(TEvent)]->push_back(std::move(subscriber));
+        typedef typename EventCallbackTraits<decltype(Callback)>::Event TEvent;
+        const int eventTypeId = EventType<TEvent>::GetId();
+        if (eventTypeId >= static_cast<int>(delegates.size()))
+            delegates.resize(eventTypeId + 1);
+
+        const std::uint64_t subscriptionId = nextSubscriptionId++;
+        delegates[eventTypeId].push_back({ownerInstance, &Invoke<Callback>, subscriptionId});
+        return EventSubscription(self, eventTypeId, subscriptionId);
     }
 
     /**
      * @name Emit an event of type <T>
-     * @brief In our implementation, as soon as something emits and event, we go ahead and execute all the listener callbacks \n
+     * @brief In our implementation, as soon as something emits and event, we go ahead and execute all the listener callbacks.
+     * The event is built once and every callback gets the same instance. Callbacks may subscribe or unsubscribe
+     * while the event is dispatched, the ones subscribed meanwhile only get the next events. \n
      * Example: eventBus->EmitEvent<CollisionEvent>(player, enemy);
      */
     template <typename TEvent, typename ...TArgs>
     void EmitEvent(TArgs&& ...args)
     {
-        auto handlerList = subscribers[typeid(TEvent)].get();
-        if (handlerList)
+        const int eventTypeId = EventType<TEvent>::GetId();
+        if (eventTypeId >= static_cast<int>(delegates.size()) || delegates[eventTypeId].empty())
+            return;
+
+        TEvent event(std::forward<TArgs>(args)...);
+
+        // Indexed on every iteration, a callback subscribing can reallocate the arrays
+        numEmitting++;
+        const size_t numDelegates = delegates[eventTypeId].size();
+        for (size_t i = 0; i < numDelegates; i++)
+        {
+            const EventDelegate delegate = delegates[eventTypeId][i];
+            if (delegate.owner)
+                delegate.function(delegate.owner, event);
+        }
+        numEmitting--;
+
+        if (numEmitting == 0 && hasUnsubscribedDelegates)
+            RemoveUnsubscribedDelegates();
+    }
+
+    /**
+     * @name Queue an event of type <T>
+     * @brief The event is appended to the queue of its type and no callback is called. The consumers
+     * read the whole queue later in the frame with GetEventQueue<T>(), so the producer and the
+     * consumers run as separate phases, each one over contiguous events. \n
+     * Example: eventBus->QueueEvent<CollisionEvent>(player, enemy);
+     */
+    template <typename TEvent, typename ...TArgs>
+    void QueueEvent(TArgs&& ...args)
+    {
+        GetEventQueue<TEvent>().Push(std::forward<TArgs>(args)...);
+    }
+
+    // Returns the queue of the events of type <T>, created empty the first time
+    template <typename TEvent>
+    EventQueue<TEvent>& GetEventQueue()
+    {
+        const int eventTypeId = EventType<TEvent>::GetId();
+        if (eventTypeId >= static_cast<int>(queues.size()))
+            queues.resize(eventTypeId + 1);
+        if (!queues[eventTypeId])
+            queues[eventTypeId] = std::make_unique<EventQueue<TEvent>>();
+
+        return static_cast<EventQueue<TEvent>&>(*queues[eventTypeId]);
+    }
+
+    // Called after every simulation step, before the registry update kills the entities the events refer to
+    void ClearQueuedEvents()
+    {
+        for (auto& queue : queues)
         {
-            for (auto it = handlerList->begin(); it != handlerList->end(); it++)
-            {
-                auto handler = it->get();
-                TEvent event(std::forward<TArgs>(args)...);
-                handler->Execute(event);
-            }
+            if (queue)
+                queue->Clear();
+        }
+    }
+
+    // Called by EventSubscription
+    void Unsubscribe(int eventTypeId, std::uint64_t subscriptionId)
+    {
+        if (eventTypeId >= static_cast<int>(delegates.size()))
+            return;
+
+        auto& eventDelegates = delegates[eventTypeId];
+        auto delegate = std::find_if(eventDelegates.begin(), eventDelegates.end(), [subscriptionId](const EventDelegate& delegate) {
+            return delegate.subscriptionId == subscriptionId;
+        });
+        if (delegate == eventDelegates.end())
+            return;
+
+        // An emit may be iterating the array, the delegate is only disabled until it returns
+        if (numEmitting > 0)
+        {
+            delegate->owner = nullptr;
+            hasUnsubscribedDelegates = true;
+        }
+        else
+        {
+            eventDelegates.erase(delegate);
         }
     }
 
 private:
-    std::map<std::type_index, std::unique_ptr<HandlerList>> subscribers;
+    // Delegates of every event type, in subscription order [Vector index = event type id]
+    std::vector<std::vector<EventDelegate>> delegates;
+
+    // Queued events of every event type [Vector index = event type id]
+    std::vector<std::unique_ptr<IEventQueue>> queues;
+
+    // Subscriptions hold a weak pointer to it, so they know when the bus is gone
+    std::shared_ptr<EventBus*> self;
+    std::uint64_t nextSubscriptionId = 1;
+
+    int numEmitting = 0;
+    bool hasUnsubscribedDelegates = false;
+
+    template <auto Callback>
+    static void Invoke(void* owner, Event& event)
+    {
+        typedef EventCallbackTraits<decltype(Callback)> Traits;
+        (static_cast<typename Traits::Owner*>(owner)->*Callback)(static_cast<typename Traits::Event&>(event));
+    }
+
+    void RemoveUnsubscribedDelegates()
+    {
+        for (auto& eventDelegates : delegates)
+        {
+            eventDelegates.erase(
+                std::remove_if(eventDelegates.begin(), eventDelegates.end(), [](const EventDelegate& delegate) { return !delegate.owner; }),
+                eventDelegates.end()
+            );
+        }
+        hasUnsubscribedDelegates = false;
+    }
 };
+
+inline void EventSubscription::Unsubscribe()
+{
+    if (id == 0)
+        return;
+    if (auto bus = eventBus.lock())
+        (*bus)->Unsubscribe(eventTypeId, id);
+    eventBus.reset();
+    id = 0;
+}
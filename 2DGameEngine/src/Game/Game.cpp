@@ -1,6 +1,13 @@
 #include "Game.h"
 
 #include "LevelLoader.h"
+#include "SimulationTime.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <iostream>
 
 #include <SDL.h>
 #include <SDL_ttf.h>
@@ -11,6 +18,12 @@
 
 #include "../Logger/Logger.h"
 #include "../ECS/ECS.h"
+#include "../AssetStore/AssetStore.h"
+#include "../Snapshot/Snapshot.h"
+#include "../Profiler/Profiler.h"
+#include "../Benchmark/FrameBenchmark.h"
+#include "../Jobs/JobSystem.h"
+#include "../Scheduler/SystemScheduler.h"
 #include "../EventBus/EventBus.h"
 #include "../Events/KeyPressedEvent.h"
 #include "../Systems/MovementSystem.h"
@@ -27,6 +40,22 @@
 #include "../Systems/RenderTextSystem.h"
 #include "../Systems/RenderDebugGuiSystem.h"
 #include "../Systems/ScriptSystem.h"
+#include "../Systems/TransformInterpolationSystem.h"
+#include "../Components/TransformComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Components/SpriteComponent.h"
+#include "../Components/AnimationComponent.h"
+#include "../Components/BoxColliderComponent.h"
+#include "../Components/HealthComponent.h"
+#include "../Components/ProjectileComponent.h"
+#include "../Components/ProjectileEmitterComponent.h"
+#include "../Components/KeyboardControlledComponent.h"
+#include "../Components/CameraFollowComponent.h"
+#include "../Components/TextLabelComponent.h"
+#include "../Components/ScriptComponent.h"
+
+// Globals set by the level scripts and used by their entity scripts, saved in the snapshots
+static const char* const LEVEL_SCRIPT_GLOBALS[] = { "map_width", "map_height" };
 
 int Game::windowHeight;
 int Game::windowWidth;
@@ -37,9 +66,12 @@ Game::Game()
 {
     isRunning = false; // Set to true after Initialization.
     isDebug = false;
+    levelScript = LevelLoader::GetLevelScript(2);
     registry = std::make_unique<Registry>();
     assetStore = std::make_unique<AssetStore>();
     eventBus = std::make_unique<EventBus>();
+    snapshot = std::make_unique<Snapshot>();
+    jobSystem = std::make_unique<JobSystem>();
     Logger::Log("Game constructor");
 }
 
@@ -50,7 +82,12 @@ Game::~Game()
 
 void Game::Initialize()
 {
-    if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
+    // Benchmarks run on machines without a display, SDL renders in memory with its dummy video driver
+    const bool isHeadless = benchmarkFrames > 0;
+    if (isHeadless)
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+
+    if (SDL_Init(isHeadless ? SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_EVENTS : SDL_INIT_EVERYTHING) != 0)
     {
         Logger::Err("Error initializing SDL.");
         return;
@@ -68,7 +105,7 @@ void Game::Initialize()
                             SDL_WINDOWPOS_CENTERED,
                             windowWidth,
                             windowHeight,
-                            SDL_WINDOW_BORDERLESS
+                            isHeadless ? SDL_WINDOW_HIDDEN : SDL_WINDOW_BORDERLESS
                             );
 
     if (!window)
@@ -77,7 +114,8 @@ void Game::Initialize()
         return;
     }
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    // No vsync in benchmarks, frames run as fast as they can
+    renderer = SDL_CreateRenderer(window, -1, isHeadless ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if (!renderer)
     {
         Logger::Err("Error creating SDL renderer.");
@@ -91,6 +129,7 @@ void Game::Initialize()
     camera.y = 0;
     camera.w = windowWidth;
     camera.h = windowHeight;
+    previousCamera = camera;
 
     // Initialize SDL_ttf
     if (TTF_Init())
@@ -108,15 +147,359 @@ void Game::Initialize()
     isRunning = true;
 }
 
-void Game::Run()
+void Game::SetSnapshotToRestore(const std::string& filePath)
+{
+    snapshotToRestore = filePath;
+}
+
+void Game::SetLevelScript(const std::string& filePath)
+{
+    levelScript = filePath;
+}
+
+void Game::SetBenchmark(int numFrames, const std::string& outputPath)
+{
+    benchmarkFrames = numFrames;
+    benchmarkOutput = outputPath;
+    benchmark = std::make_unique<FrameBenchmark>();
+}
+
+void Game::SetupSnapshot()
+{
+    // Restoring doesn't run the level script again. The globals its entity scripts use are saved instead,
+    // the script functions themselves are saved as source with their ScriptComponent.
+    snapshot->RegisterSection("level",
+        [this](SnapshotWriter& writer)
+        {
+            writer.WriteString(levelScript);
+            writer.Write<std::int32_t>(static_cast<std::int32_t>(std::size(LEVEL_SCRIPT_GLOBALS)));
+            for (const char* name : LEVEL_SCRIPT_GLOBALS)
+            {
+                const sol::optional<double> value = lua[name];
+                writer.WriteString(name);
+                writer.Write<std::uint8_t>(value ? 1 : 0);
+                writer.Write<double>(value.value_or(0.0));
+            }
+        },
+        [this](SnapshotReader& reader)
+        {
+            std::string savedLevelScript;
+            reader.ReadString(savedLevelScript);
+            std::int32_t numGlobals = 0;
+            reader.Read(numGlobals);
+            for (int i = 0; i < numGlobals && reader.IsValid(); i++)
+            {
+                std::string name;
+                std::uint8_t hasValue = 0;
+                double value = 0.0;
+                reader.ReadString(name);
+                reader.Read(hasValue);
+                reader.Read(value);
+                if (reader.IsValid() && hasValue)
+                    lua[name] = value;
+            }
+            if (reader.IsValid())
+                levelScript = savedLevelScript;
+        });
+    snapshot->RegisterSection("time",
+        [](SnapshotWriter& writer) { writer.Write<double>(SimulationTime::GetMilliseconds()); },
+        [](SnapshotReader& reader)
+        {
+            double milliseconds = 0.0;
+            reader.Read(milliseconds);
+            if (reader.IsValid())
+                SimulationTime::SetMilliseconds(milliseconds);
+        });
+    snapshot->RegisterSection("map",
+        [](SnapshotWriter& writer)
+        {
+            writer.Write<std::int32_t>(mapWidth);
+            writer.Write<std::int32_t>(mapHeight);
+        },
+        [](SnapshotReader& reader)
+        {
+            std::int32_t width = 0;
+            std::int32_t height = 0;
+            reader.Read(width);
+            reader.Read(height);
+            mapWidth = width;
+            mapHeight = height;
+        });
+    snapshot->RegisterSection("assets",
+        [this](SnapshotWriter& writer)
+        {
+            writer.Write<std::int32_t>(static_cast<std::int32_t>(assetStore->GetTextureFiles().size()));
+            for (const auto& texture : assetStore->GetTextureFiles())
+            {
+                writer.WriteString(texture.first);
+                writer.WriteString(texture.second);
+            }
+            writer.Write<std::int32_t>(static_cast<std::int32_t>(assetStore->GetFontFiles().size()));
+            for (const auto& font : assetStore->GetFontFiles())
+            {
+                writer.WriteString(font.first);
+                writer.WriteString(font.second.first);
+                writer.Write<std::int32_t>(font.second.second);
+            }
+        },
+        [this](SnapshotReader& reader)
+        {
+            std::int32_t numTextures = 0;
+            reader.Read(numTextures);
+            for (int i = 0; i < numTextures && reader.IsValid(); i++)
+            {
+                std::string assetId, filePath;
+                reader.ReadString(assetId);
+                reader.ReadString(filePath);
+                if (reader.IsValid())
+                    assetStore->AddTexture(renderer, assetId, filePath);
+            }
+            std::int32_t numFonts = 0;
+            reader.Read(numFonts);
+            for (int i = 0; i < numFonts && reader.IsValid(); i++)
+            {
+                std::string assetId, filePath;
+                std::int32_t fontSize = 0;
+                reader.ReadString(assetId);
+                reader.ReadString(filePath);
+                reader.Read(fontSize);
+                if (reader.IsValid())
+                    assetStore->AddFont(assetId, filePath, fontSize);
+            }
+        });
+
+    // Plain data components are saved as raw blocks
+    snapshot->RegisterComponent<TransformComponent>("transform");
+    snapshot->RegisterComponent<RigidBodyComponent>("rigidbody");
+    snapshot->RegisterComponent<BoxColliderComponent>("boxcollider");
+    snapshot->RegisterComponent<HealthComponent>("health");
+    snapshot->RegisterComponent<KeyboardControlledComponent>("keyboardcontrolled");
+    snapshot->RegisterComponent<CameraFollowComponent>("camerafollow");
+
+    // Their timers count simulation time, which is saved in the "time" section
+    snapshot->RegisterComponent<AnimationComponent>("animation");
+    snapshot->RegisterComponent<ProjectileComponent>("projectile");
+    snapshot->RegisterComponent<ProjectileEmitterComponent>("projectileemitter");
+
+    // Components holding strings write them one field at a time
+    snapshot->RegisterComponent<SpriteComponent>("sprite",
+        [](SnapshotWriter& writer, const SpriteComponent& sprite)
+        {
+            writer.WriteString(sprite.assetId);
+            writer.Write<std::int32_t>(sprite.width);
+            writer.Write<std::int32_t>(sprite.height);
+            writer.Write<std::int32_t>(sprite.zIndex);
+            writer.Write(sprite.isFixed);
+            writer.Write(sprite.srcRect);
+            writer.Write<std::int32_t>(sprite.flip);
+        },
+        [](SnapshotReader& reader, SpriteComponent& sprite)
+        {
+            std::int32_t width = 0, height = 0, zIndex = 0, flip = 0;
+            reader.ReadString(sprite.assetId);
+            reader.Read(width);
+            reader.Read(height);
+            reader.Read(zIndex);
+            reader.Read(sprite.isFixed);
+            reader.Read(sprite.srcRect);
+            reader.Read(flip);
+            sprite.width = width;
+            sprite.height = height;
+            sprite.zIndex = zIndex;
+            sprite.flip = static_cast<SDL_RendererFlip>(flip);
+        });
+    snapshot->RegisterComponent<TextLabelComponent>("textlabel",
+        [](SnapshotWriter& writer, const TextLabelComponent& label)
+        {
+            writer.Write(label.position);
+            writer.WriteString(label.text);
+            writer.WriteString(label.assetId);
+            writer.Write(label.color);
+            writer.Write(label.isFixed);
+        },
+        [](SnapshotReader& reader, TextLabelComponent& label)
+        {
+            reader.Read(label.position);
+            reader.ReadString(label.text);
+            reader.ReadString(label.assetId);
+            reader.Read(label.color);
+            reader.Read(label.isFixed);
+        });
+
+    // Scripts are saved as Lua source and compiled again as text, a snapshot never loads bytecode.
+    // Only the _ENV upvalue is restored, which is all the level scripts use.
+    snapshot->RegisterComponent<ScriptComponent>("script",
+        [this](SnapshotWriter& writer, const ScriptComponent& script)
+        {
+            writer.WriteString(script.func.valid() ? GetScriptSource(script.func) : std::string());
+        },
+        [this](SnapshotReader& reader, ScriptComponent& script)
+        {
+            std::string source;
+            reader.ReadString(source);
+            if (source.empty())
+                return;
+
+            // The chunk only builds the function, it runs without globals so a tampered file can't call anything
+            lua_State* state = lua.lua_state();
+            const std::string chunk = "return " + source;
+            bool isLoaded = luaL_loadbufferx(state, chunk.data(), chunk.size(), "=snapshot", "t") == LUA_OK;
+            if (isLoaded)
+            {
+                lua_newtable(state);
+                lua_setupvalue(state, -2, 1);
+                isLoaded = lua_pcall(state, 0, 1, 0) == LUA_OK && lua_isfunction(state, -1);
+            }
+            if (!isLoaded)
+            {
+                Logger::Err(std::string("Cannot restore script from snapshot: ") + (lua_isstring(state, -1) ? lua_tostring(state, -1) : "not a function"));
+                lua_pop(state, 1);
+                return;
+            }
+
+            // Its only possible upvalue is _ENV, which the scripts get back
+            lua_pushglobaltable(state);
+            if (!lua_setupvalue(state, -2, 1))
+                lua_pop(state, 1);
+            script.func = sol::function(state, -1);
+            lua_pop(state, 1);
+        });
+}
+
+std::string Game::GetScriptSource(const sol::function& func)
+{
+    lua_State* state = lua.lua_state();
+    lua_Debug info;
+    func.push(state);
+    lua_getinfo(state, ">S", &info);
+    if (info.linedefined <= 0)
+    {
+        Logger::Err("Cannot save a script that is not a Lua function defined in a script");
+        return std::string();
+    }
+
+    // Many entities share the same function, its text is only cut from the script once
+    const std::string key = std::string(info.source) + ":" + std::to_string(info.linedefined);
+    const auto cached = scriptSources.find(key);
+    if (cached != scriptSources.end())
+        return cached->second;
+
+    // Files are named "@path", chunks loaded from a string are named after their text
+    std::string chunk;
+    if (info.source[0] == '@')
+    {
+        std::ifstream file(info.source + 1, std::ios::binary);
+        chunk.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    else if (info.source[0] != '=')
+    {
+        chunk = info.source;
+    }
+
+    // Find the lines the function spans, it starts at its "function" keyword
+    size_t lineStart = 0;
+    size_t firstLineStart = std::string::npos;
+    for (int line = 1; line < info.lastlinedefined && lineStart != std::string::npos; line++)
+    {
+        if (line == info.linedefined)
+            firstLineStart = lineStart;
+        lineStart = chunk.find('\n', lineStart);
+        if (lineStart != std::string::npos)
+            lineStart++;
+    }
+    if (info.linedefined == info.lastlinedefined)
+        firstLineStart = lineStart;
+    const size_t lastLineStart = lineStart;
+    const size_t keyword = firstLineStart == std::string::npos ? std::string::npos : chunk.find("function", firstLineStart);
+    const size_t parameters = keyword == std::string::npos ? std::string::npos : chunk.find('(', keyword);
+    const size_t lastLineEnd = lastLineStart == std::string::npos ? std::string::npos : std::min(chunk.find('\n', lastLineStart), chunk.size());
+
+    // Its last line may go on after its "end", keep the shortest text that compiles as a function
+    std::string source;
+    for (size_t end = parameters == std::string::npos || lastLineEnd == std::string::npos ? std::string::npos : chunk.find("end", std::max(lastLineStart, parameters));
+        end != std::string::npos && end < lastLineEnd;
+        end = chunk.find("end", end + 1))
+    {
+        const std::string candidate = "function" + chunk.substr(parameters, end + 3 - parameters);
+        const std::string candidateChunk = "return " + candidate;
+        const bool isFunction = luaL_loadbufferx(state, candidateChunk.data(), candidateChunk.size(), "=snapshot", "t") == LUA_OK;
+        lua_pop(state, 1);
+        if (isFunction)
+        {
+            source = candidate;
+            break;
+        }
+    }
+    if (source.empty())
+        Logger::Err(std::string("Cannot find the source of the script defined at ") + info.short_src + ":" + std::to_string(info.linedefined));
+
+    scriptSources[key] = source;
+    return source;
+}
+
+bool Game::Run()
 {
     Setup(); 
+
+    // Loading the level doesn't count as simulation time
+    previousFrameCounter = SDL_GetPerformanceCounter();
     while (isRunning)
     {
+        Profiler::BeginFrame();
         ProcessInput();
         Update();
         Render();
+        Profiler::EndFrame();
+
+        if (benchmark)
+            RecordBenchmarkFrame();
     }
+
+    if (!isLevelLoaded)
+        return false;
+
+    if (benchmark)
+    {
+        // A partial run would be compared with complete ones, no report is written
+        if (benchmark->GetNumFrames() < benchmarkFrames)
+        {
+            Logger::Err("Benchmark stopped after " + std::to_string(benchmark->GetNumFrames()) + " of " + std::to_string(benchmarkFrames) + " frames, no report written");
+            return false;
+        }
+        return WriteBenchmarkReport();
+    }
+    return true;
+}
+
+void Game::RecordBenchmarkFrame()
+{
+    benchmark->AddFrame();
+    benchmark->AddCounter("entities", registry->GetNumEntities());
+    benchmark->AddCounter("collisionPairsTested", static_cast<double>(registry->GetSystem<CollisionSystem>().GetNumPairsTested()));
+    benchmark->AddCounter("collisions", registry->GetSystem<CollisionSystem>().GetNumCollisions());
+
+    if (benchmark->GetNumFrames() >= benchmarkFrames)
+        isRunning = false;
+}
+
+bool Game::WriteBenchmarkReport()
+{
+    if (benchmarkOutput == "-")
+    {
+        benchmark->WriteReport(std::cout, levelScript);
+        std::cout.flush();
+        return static_cast<bool>(std::cout);
+    }
+
+    std::ofstream file(benchmarkOutput, std::ios::trunc);
+    benchmark->WriteReport(file, levelScript);
+    if (!file)
+    {
+        Logger::Err("Failed to write the benchmark report to " + benchmarkOutput);
+        return false;
+    }
+    Logger::Log("Benchmark report of " + std::to_string(benchmark->GetNumFrames()) + " frames written to " + benchmarkOutput);
+    return true;
 }
 
 void Game::Setup()
@@ -136,17 +519,89 @@ void Game::Setup()
     registry->AddSystem<RenderHealthBarSystem>();
     registry->AddSystem<RenderDebugGuiSystem>();
     registry->AddSystem<ScriptSystem>();
+    registry->AddSystem<TransformInterpolationSystem>();
+
+    // Subscriptions last as long as the systems, they are not redone every frame
+    registry->GetSystem<KeyboardControlSystem>().SubscribeToEvents(eventBus);
+    registry->GetSystem<ProjectileEmitSystem>().SubscribeToEvents(eventBus);
+
+    // Order the updates of a frame, the scheduler runs the ones that don't conflict at the same time
+    scheduler = std::make_unique<SystemScheduler>(*registry, *jobSystem);
+    scheduler->AddSystem("Movement", registry->GetSystem<MovementSystem>(), [this](CommandBuffer& commands) {
+        registry->GetSystem<MovementSystem>().Update(registry, *jobSystem, FIXED_DELTA_TIME, commands);
+    });
+    scheduler->AddSystem("ProjectileLifecycle", registry->GetSystem<ProjectileLifecycleSystem>(), [this](CommandBuffer& commands) {
+        registry->GetSystem<ProjectileLifecycleSystem>().Update(commands);
+    });
+    scheduler->AddSystem("Animation", registry->GetSystem<AnimationSystem>(), [this](CommandBuffer&) {
+        registry->GetSystem<AnimationSystem>().Update(registry);
+    });
+    scheduler->AddSystem("CameraMovement", registry->GetSystem<CameraMovementSystem>(), [this](CommandBuffer&) {
+        registry->GetSystem<CameraMovementSystem>().Update(camera);
+    });
+    scheduler->AddSystem("Collision", registry->GetSystem<CollisionSystem>(), [this](CommandBuffer&) {
+        registry->GetSystem<CollisionSystem>().Update(registry, *jobSystem, eventBus);
+    });
+    // Collision response, after the Collision step queued the collisions of this step
+    scheduler->AddSystem("MovementCollisions", registry->GetSystem<MovementSystem>(), [this](CommandBuffer&) {
+        registry->GetSystem<MovementSystem>().ProcessCollisions(eventBus);
+    });
+    scheduler->AddSystem("Damage", registry->GetSystem<DamageSystem>(), [this](CommandBuffer& commands) {
+        registry->GetSystem<DamageSystem>().Update(eventBus, commands);
+    });
+    scheduler->AddSystem("ProjectileEmit", registry->GetSystem<ProjectileEmitSystem>(), [this](CommandBuffer&) {
+        registry->GetSystem<ProjectileEmitSystem>().Update(registry);
+    });
+    scheduler->AddSystem("Script", registry->GetSystem<ScriptSystem>(), [this](CommandBuffer&) {
+        registry->GetSystem<ScriptSystem>().Update(FIXED_DELTA_TIME, SimulationTime::GetTicks());
+    });
 
     // Create the bindings between C++ and Lua
     registry->GetSystem<ScriptSystem>().CreateLuaBindings(lua);
     
-    LevelLoader loader;
     lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::os);
-    loader.LoadLevel(lua, registry, assetStore, renderer, 2);
+
+    // The benchmark report may be written to stdout, the scripts print through the Logger instead (on stderr)
+    if (benchmark)
+    {
+        lua.set_function("print", [](sol::this_state state, sol::variadic_args args) {
+            sol::state_view luaState(state);
+            sol::function toString = luaState["tostring"];
+            std::string message;
+            for (auto arg : args)
+            {
+                if (!message.empty())
+                    message += '\t';
+                message += toString(arg).get<std::string>();
+            }
+            Logger::Log(message);
+        });
+    }
+
+    SetupSnapshot();
+    if (!snapshotToRestore.empty())
+    {
+        if (snapshot->Load(*registry, snapshotToRestore))
+        {
+            isLevelLoaded = true;
+            return;
+        }
+
+        // Assets of a half-read snapshot would clash with the ones of the level
+        assetStore->ClearAssets();
+        Logger::Err("Loading level " + levelScript + " instead of the snapshot");
+    }
+
+    LevelLoader loader;
+    isLevelLoaded = loader.LoadLevel(lua, registry, assetStore, renderer, levelScript);
+    if (!isLevelLoaded && benchmark)
+        isRunning = false;
 }
 
 void Game::ProcessInput()
 {
+    PROFILE_ZONE("Input");
+
     SDL_Event e;
     while (SDL_PollEvent(&e))
     {
@@ -168,6 +623,10 @@ void Game::ProcessInput()
             {
                 isDebug = !isDebug;
             }
+            if (e.key.keysym.sym == SDLK_F5)
+            {
+                snapshot->Save(*registry, "snapshot.bin");
+            }
             break;
         case SDL_QUIT:
             isRunning = false;
@@ -180,53 +639,98 @@ void Game::ProcessInput()
 
 void Game::Update()
 {
-    /*int timeToWait = MILLISECS_PER_FRAME - (SDL_GetTicks() - millisecsPreviousFrame);
-    if (timeToWait > 0 && timeToWait <= MILLISECS_PER_FRAME)
-        SDL_Delay(timeToWait);*/
+    PROFILE_ZONE("Update");
 
-    double deltaTime = (SDL_GetTicks() - millisecsPreviousFrame) / 1000.0f;
-    millisecsPreviousFrame = SDL_GetTicks();
+    // Measure the real time elapsed since the previous frame with the high resolution counter.
+    // Benchmarks run exactly one step per frame, so every run simulates the same steps.
+    const std::uint64_t frameCounter = SDL_GetPerformanceCounter();
+    if (benchmark)
+        unsimulatedTime += FIXED_DELTA_TIME;
+    else
+        unsimulatedTime += static_cast<double>(frameCounter - previousFrameCounter) / SDL_GetPerformanceFrequency();
+    previousFrameCounter = frameCounter;
 
-    // Reset all event handlers
-    eventBus->Reset();
-    
-    // Perform the subscription of the events for all systems
-    registry->GetSystem<DamageSystem>().SubscribeToEvents(eventBus);
-    registry->GetSystem<KeyboardControlSystem>().SubscribeToEvents(eventBus);
-    registry->GetSystem<ProjectileEmitSystem>().SubscribeToEvents(eventBus);
-    registry->GetSystem<MovementSystem>().SubscribeToEvents(eventBus);
-    
-    // Ask all the systems to update.
-    registry->GetSystem<MovementSystem>().Update(deltaTime);
-    registry->GetSystem<AnimationSystem>().Update();
-    registry->GetSystem<CollisionSystem>().Update(eventBus);
-    registry->GetSystem<DamageSystem>().Update();
-    registry->GetSystem<CameraMovementSystem>().Update(camera);
-    registry->GetSystem<ProjectileEmitSystem>().Update(registry);
-    registry->GetSystem<ProjectileLifecycleSystem>().Update();
-    registry->GetSystem<ScriptSystem>().Update(deltaTime, SDL_GetTicks());
-    
-    // Update the registry to process the entities that are waiting to be created/deleted
-    registry->Update();
+    // Run one simulation step per FIXED_DELTA_TIME elapsed
+    int numSteps = 0;
+    while (unsimulatedTime >= FIXED_DELTA_TIME && numSteps < MAX_SIMULATION_STEPS_PER_FRAME)
+    {
+        PROFILE_ZONE("Simulation step");
+
+        // Keep the state before the step for the render interpolation
+        previousCamera = camera;
+        {
+            PROFILE_ZONE("TransformInterpolation");
+            registry->GetSystem<TransformInterpolationSystem>().SaveStates(registry);
+        }
+
+        // Ask all the systems to update, the scheduler times each of them
+        scheduler->Run();
+
+        // Every queued event has been consumed, and the next registry update can kill their entities
+        eventBus->ClearQueuedEvents();
+
+        // Update the registry to process the entities that are waiting to be created/deleted
+        {
+            PROFILE_ZONE("Registry");
+            registry->Update();
+        }
+
+        // The gameplay timers only move with the simulation
+        SimulationTime::Advance(FIXED_DELTA_TIME);
+
+        unsimulatedTime -= FIXED_DELTA_TIME;
+        numSteps++;
+    }
+
+    // Too far behind (e.g. after a breakpoint), the simulation slows down instead of catching up
+    if (numSteps == MAX_SIMULATION_STEPS_PER_FRAME && unsimulatedTime >= FIXED_DELTA_TIME)
+        unsimulatedTime = std::fmod(unsimulatedTime, FIXED_DELTA_TIME);
+
+    // Render between the last two steps, according to how much of the next step already elapsed
+    registry->GetSystem<TransformInterpolationSystem>().SetAlpha(unsimulatedTime / FIXED_DELTA_TIME);
 }
 
 void Game::Render()
 {
+    PROFILE_ZONE("Render");
+
     SDL_SetRenderDrawColor(renderer, 21, 21, 21, 255); // Background color.
     SDL_RenderClear(renderer);
 
+    // The camera and the transforms are rendered between the last two simulation steps
+    const auto& interpolation = registry->GetSystem<TransformInterpolationSystem>();
+    SDL_Rect renderCamera = interpolation.Interpolate(previousCamera, camera);
+
     // Render Game Objects.
-    registry->GetSystem<RenderSystem>().Update(renderer, assetStore, camera);
-    registry->GetSystem<RenderTextSystem>().Update(renderer, assetStore, camera);
-    registry->GetSystem<RenderHealthBarSystem>().Update(renderer, assetStore, camera);
+    {
+        PROFILE_ZONE("RenderSystem");
+        registry->GetSystem<RenderSystem>().Update(renderer, registry, *jobSystem, assetStore, interpolation, renderCamera);
+    }
+    {
+        PROFILE_ZONE("RenderText");
+        registry->GetSystem<RenderTextSystem>().Update(renderer, assetStore, renderCamera);
+    }
+    {
+        PROFILE_ZONE("RenderHealthBar");
+        registry->GetSystem<RenderHealthBarSystem>().Update(renderer, assetStore, interpolation, renderCamera);
+    }
     
     if (isDebug)
     {
-        registry->GetSystem<RenderCollisionSystem>().Update(renderer, camera);
-        registry->GetSystem<RenderDebugGuiSystem>().Update(renderer, registry, camera);
+        {
+            PROFILE_ZONE("RenderCollision");
+            registry->GetSystem<RenderCollisionSystem>().Update(renderer, interpolation, renderCamera);
+        }
+        {
+            PROFILE_ZONE("RenderDebugGui");
+            registry->GetSystem<RenderDebugGuiSystem>().Update(renderer, registry, *scheduler, lua, renderCamera);
+        }
     }
     
-    SDL_RenderPresent(renderer);
+    {
+        PROFILE_ZONE("Present");
+        SDL_RenderPresent(renderer);
+    }
 }
 
 void Game::Destroy()
@@ -1,17 +1,28 @@
 #pragma once
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 #include "SDL_rect.h"
 #include <sol/sol.hpp>
 
-//const int FPS = 60;
-//const int MILLISECS_PER_FRAME = 1000 / FPS; // 1S = 1000ms
+// The simulation advances in fixed steps, rendering blends the last two steps to stay smooth at any refresh rate
+const int SIMULATION_STEPS_PER_SECOND = 60;
+const double FIXED_DELTA_TIME = 1.0 / SIMULATION_STEPS_PER_SECOND;
+
+// Most steps run in one frame, the time beyond it is dropped so a long frame doesn't snowball
+const int MAX_SIMULATION_STEPS_PER_FRAME = 5;
 
 struct SDL_Window;
 struct SDL_Renderer;
 class Registry;
 class AssetStore;
 class EventBus;
+class Snapshot;
+class SystemScheduler;
+class JobSystem;
+class FrameBenchmark;
 
 class Game
 {
@@ -20,32 +31,67 @@ public:
     ~Game();
 
     void Initialize();
-    void Run();
+
+    // Returns false when the level couldn't be loaded, or when a benchmark didn't run all its frames
+    bool Run();
     void Setup();
     void ProcessInput();
     void Update();
     void Render();
     void Destroy();
 
+    // Restores the game from a snapshot file in Setup() instead of loading the level
+    void SetSnapshotToRestore(const std::string& filePath);
+
+    // Loads this Lua level script instead of the default level
+    void SetLevelScript(const std::string& filePath);
+
+    // Runs headless (dummy video driver, no window shown) for numFrames frames of exactly one simulation step,
+    // then writes the timings of every system as JSON to outputPath ("-" for the standard output).
+    // Must be called before Initialize().
+    void SetBenchmark(int numFrames, const std::string& outputPath);
+
     static int windowWidth;
     static int windowHeight;
     static int mapWidth;
     static int mapHeight;
 
 private:
+    void SetupSnapshot();
+    // Text of a script function as "function(...) ... end", cut from the script that defined it
+    std::string GetScriptSource(const sol::function& func);
+    void RecordBenchmarkFrame();
+    bool WriteBenchmarkReport();
+
     bool isRunning;
     bool isDebug;
     
-    int millisecsPreviousFrame = 0;
+    // High resolution counter value of the previous frame, and real time not simulated yet (in seconds)
+    std::uint64_t previousFrameCounter = 0;
+    double unsimulatedTime = 0.0;
+
+    std::string levelScript;
+    std::string snapshotToRestore;
+    // Script sources already found by GetScriptSource(), by script name and line of definition
+    std::unordered_map<std::string, std::string> scriptSources;
+    bool isLevelLoaded = false;
+
+    int benchmarkFrames = 0;
+    std::string benchmarkOutput;
+    std::unique_ptr<FrameBenchmark> benchmark;
     
     SDL_Window* window;
     SDL_Renderer* renderer;
 
     SDL_Rect camera;
+    SDL_Rect previousCamera;
 
     sol::state lua;
     
     std::unique_ptr<Registry> registry;
     std::unique_ptr<AssetStore> assetStore;
     std::unique_ptr<EventBus> eventBus;
+    std::unique_ptr<Snapshot> snapshot;
+    std::unique_ptr<JobSystem> jobSystem;
+    std::unique_ptr<SystemScheduler> scheduler;
 };
@@ -34,10 +34,13 @@ LevelLoader::~LevelLoader()
     Logger::Log("LevelLoader destructor");
 }
 
-void LevelLoader::LoadLevel(sol::state& lua, const std::unique_ptr<Registry>& registry, const std::unique_ptr<AssetStore>& assetStore, SDL_Renderer* renderer, int level)
+std::string LevelLoader::GetLevelScript(int level)
 {
-    const std::string scriptPath = "assets/scripts/Level" + std::to_string(level) + ".lua";
+    return "assets/scripts/Level" + std::to_string(level) + ".lua";
+}
 
+bool LevelLoader::LoadLevel(sol::state& lua, const std::unique_ptr<Registry>& registry, const std::unique_ptr<AssetStore>& assetStore, SDL_Renderer* renderer, const std::string& scriptPath)
+{
     // Only loads the script and checks for script errors
     sol::load_result script = lua.load_file(scriptPath);
 
@@ -45,11 +48,11 @@ void LevelLoader::LoadLevel(sol::state& lua, const std::unique_ptr<Registry>& re
     {
         sol::error err = script;
         Logger::Err("Script at " + scriptPath + " has error " + err.what());
-        return;
+        return false;
     }
 
     // Executes the lua script
-    lua.script_file("assets/scripts/Level" + std::to_string(level) + ".lua");
+    lua.script_file(scriptPath);
 
     // Read the big table for the current level
     sol::table levelTable = lua["Level"];
@@ -89,20 +92,29 @@ void LevelLoader::LoadLevel(sol::state& lua, const std::unique_ptr<Registry>& re
     double mapScale = map["scale"];
     std::fstream mapFile;
     mapFile.open(mapFilePath);
-    for (int y = 0; y < mapNumRows; y++) {
-        for (int x = 0; x < mapNumCols; x++) {
-            char ch;
-            mapFile.get(ch);
-            int srcRectY = std::atoi(&ch) * tileSize;
-            mapFile.get(ch);
-            int srcRectX = std::atoi(&ch) * tileSize;
-            mapFile.ignore();
 
-            Entity tile = registry->CreateEntity();
-            tile.AddComponent<TransformComponent>(glm::vec2(x * (mapScale * tileSize), y * (mapScale * tileSize)), glm::vec2(mapScale, mapScale), 0.0);
-            tile.AddComponent<SpriteComponent>(mapTextureAssetId, tileSize, tileSize, 0, false, srcRectX, srcRectY);
-        }
-    }
+    // Every tile shares the same components, they are all created in one batch and only their
+    // position and source rectangle are set per tile (tiles are instantiated row by row)
+    Prefab tilePrefab;
+    tilePrefab.AddComponent<TransformComponent>(glm::vec2(0, 0), glm::vec2(mapScale, mapScale), 0.0);
+    tilePrefab.AddComponent<SpriteComponent>(mapTextureAssetId, tileSize, tileSize, 0, false);
+    registry->Instantiate(tilePrefab, mapNumRows * mapNumCols, [&](Entity tile, int index)
+    {
+        const int x = index % mapNumCols;
+        const int y = index / mapNumCols;
+
+        char ch;
+        mapFile.get(ch);
+        int srcRectY = std::atoi(&ch) * tileSize;
+        mapFile.get(ch);
+        int srcRectX = std::atoi(&ch) * tileSize;
+        mapFile.ignore();
+
+        tile.GetComponent<TransformComponent>().position = glm::vec2(x * (mapScale * tileSize), y * (mapScale * tileSize));
+        auto& sprite = tile.GetComponent<SpriteComponent>();
+        sprite.srcRect.x = srcRectX;
+        sprite.srcRect.y = srcRectY;
+    });
     mapFile.close();
     Game::mapWidth = mapNumCols * tileSize * mapScale;
     Game::mapHeight = mapNumRows * tileSize * mapScale;
@@ -123,13 +135,13 @@ void LevelLoader::LoadLevel(sol::state& lua, const std::unique_ptr<Registry>& re
         // Tag
         sol::optional<std::string> tag = entity["tag"];
         if (tag != sol::nullopt) {
-            newEntity.Tag(entity["tag"]);
+            newEntity.Tag(tag.value());
         }
 
         // Group
         sol::optional<std::string> group = entity["group"];
         if (group != sol::nullopt) {
-            newEntity.Group(entity["group"]);
+            newEntity.Group(group.value());
         }
 
         // Components
@@ -255,7 +267,7 @@ void LevelLoader::LoadLevel(sol::state& lua, const std::unique_ptr<Registry>& re
             if (script != sol::nullopt)
             {
                 sol::function func = entity["components"]["on_update_script"][0];
-                newEntity.AddComponent<ScriptComponent>(func);
+                newEntity.AddComponent<ScriptComponent>(std::move(func));
             }
         }
         i++;
@@ -393,4 +405,6 @@ void LevelLoader::LoadLevel(sol::state& lua, const std::unique_ptr<Registry>& re
     Entity label = registry->CreateEntity();
     SDL_Color green = {0, 255, 0, 255};
     label.AddComponent<TextLabelComponent>(glm::vec2(Game::windowWidth/2 - 40, 10), "CHOPPER 1.0", "charriot-font", green, true);*/
+
+    return true;
 }
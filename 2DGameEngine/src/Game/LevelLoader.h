@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 #include "SDL_render.h"
 #include <sol/sol.hpp>
@@ -14,5 +15,9 @@ public:
     LevelLoader();
     ~LevelLoader();
 
-    void LoadLevel(sol::state& lua, const std::unique_ptr<Registry>& registry, const std::unique_ptr<AssetStore>& assetStore, SDL_Renderer* renderer, int level);
+    // Path of the script of one of the numbered levels shipped with the game
+    static std::string GetLevelScript(int level);
+
+    // Runs the level script and creates its assets, tilemap and entities. Returns false if the script has errors.
+    bool LoadLevel(sol::state& lua, const std::unique_ptr<Registry>& registry, const std::unique_ptr<AssetStore>& assetStore, SDL_Renderer* renderer, const std::string& scriptPath);
 };
@@ -0,0 +1,23 @@
+#pragma once
+
+/**
+ * @name SimulationTime
+ * @brief Milliseconds simulated since the level started, advanced by one fixed step after every simulation step.
+ * The gameplay timers (animations, projectile lifetimes, emitter cooldowns, scripts) read it instead of the
+ * wall clock, so a run simulates the same thing however fast the machine is, and the timers saved in a
+ * snapshot stay valid once the clock is restored with them.
+ */
+class SimulationTime
+{
+public:
+    static int GetTicks() { return static_cast<int>(milliseconds); }
+
+    static void Advance(double seconds) { milliseconds += seconds * 1000.0; }
+
+    // Used when restoring a snapshot
+    static double GetMilliseconds() { return milliseconds; }
+    static void SetMilliseconds(double value) { milliseconds = value; }
+
+private:
+    inline static double milliseconds = 0.0;
+};
@@ -0,0 +1,295 @@
+#include "StressSceneGenerator.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Game.h"
+#include "../Logger/Logger.h"
+#include "../ECS/ECS.h"
+#include "../Components/TransformComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Components/SpriteComponent.h"
+#include "../Components/AnimationComponent.h"
+#include "../Components/BoxColliderComponent.h"
+#include "../Components/HealthComponent.h"
+#include "../Components/ProjectileEmitterComponent.h"
+#include "../Components/ScriptComponent.h"
+
+namespace
+{
+    const int TILE_SIZE = 32;
+    const double TILE_SCALE = 2.0;
+    const int ENTITY_SIZE = 32;
+
+    // Shared by every plane, it keeps them inside the map and facing where they fly
+    const char* PLANE_SCRIPT = R"(
+function stress_plane_update(entity, delta_time, ellapsed_time)
+    local position_x, position_y = get_position(entity)
+    local velocity_x, velocity_y = get_velocity(entity)
+    if position_x < 0 then velocity_x = math.abs(velocity_x) end
+    if position_x > map_width - 32 then velocity_x = -math.abs(velocity_x) end
+    if position_y < 0 then velocity_y = math.abs(velocity_y) end
+    if position_y > map_height - 32 then velocity_y = -math.abs(velocity_y) end
+    set_velocity(entity, velocity_x, velocity_y)
+    set_rotation(entity, math.deg(math.atan(velocity_x, -velocity_y)))
+end
+)";
+
+    enum class SceneEntityKind
+    {
+        Tank,
+        Plane,
+        Obstacle
+    };
+
+    struct SceneEntity
+    {
+        SceneEntityKind kind;
+        std::string textureAssetId;
+        glm::vec2 position;
+        glm::vec2 velocity;
+        double rotation;
+        glm::vec2 projectileVelocity;
+        int repeatFrequency; // seconds
+    };
+
+    // Only the raw mt19937 output is used, the std distributions give different numbers on each standard library
+    class SceneRandom
+    {
+    public:
+        SceneRandom(unsigned int seed) : engine(seed) {}
+
+        float Uniform(float min, float max) { return min + (max - min) * static_cast<float>(engine() / 4294967296.0); }
+        int Pick(int count) { return static_cast<int>(engine() % static_cast<unsigned int>(count)); }
+
+    private:
+        std::mt19937 engine;
+    };
+
+    std::vector<SceneEntity> GenerateEntities(const StressSceneSettings& settings, float mapWidth, float mapHeight)
+    {
+        SceneRandom random(settings.seed);
+        std::vector<SceneEntity> entities;
+
+        const float maxX = std::max(mapWidth - ENTITY_SIZE, 0.0f);
+        const float maxY = std::max(mapHeight - ENTITY_SIZE, 0.0f);
+        const float pi = 3.14159265f;
+
+        // Tanks drive along one axis with the matching texture and fire in a random direction
+        const char* directions[] = {"up", "right", "down", "left"};
+        const glm::vec2 directionVectors[] = {{0, -1}, {1, 0}, {0, 1}, {-1, 0}};
+        for (int i = 0; i < settings.numTanks; i++)
+        {
+            const int direction = random.Pick(4);
+            const std::string model = random.Pick(2) == 0 ? "panther" : "tiger";
+            const glm::vec2 position(random.Uniform(0, maxX), random.Uniform(0, maxY));
+            const float speed = random.Uniform(10, 40);
+            const float projectileAngle = random.Uniform(0, 2 * pi);
+            const int repeatFrequency = 1 + random.Pick(4);
+            entities.push_back({
+                SceneEntityKind::Tank,
+                "tank-" + model + "-" + directions[direction] + "-texture",
+                position,
+                directionVectors[direction] * speed,
+                0.0,
+                glm::vec2(glm::cos(projectileAngle), glm::sin(projectileAngle)) * 100.0f,
+                repeatFrequency
+            });
+        }
+
+        for (int i = 0; i < settings.numPlanes; i++)
+        {
+            const std::string model = random.Pick(2) == 0 ? "su27" : "f22";
+            const glm::vec2 position(random.Uniform(0, maxX), random.Uniform(0, maxY));
+            const float angle = random.Uniform(0, 2 * pi);
+            const float speed = random.Uniform(30, 80);
+            const glm::vec2 velocity = glm::vec2(glm::cos(angle), glm::sin(angle)) * speed;
+            entities.push_back({
+                SceneEntityKind::Plane,
+                model + "-texture",
+                position,
+                velocity,
+                glm::degrees(glm::atan(velocity.x, -velocity.y)),
+                glm::vec2(0),
+                0
+            });
+        }
+
+        // Obstacles use the 32x32 rocks and trees of Level2.lua
+        for (int i = 0; i < settings.numObstacles; i++)
+        {
+            const int texture = random.Pick(14);
+            const glm::vec2 position(random.Uniform(0, maxX), random.Uniform(0, maxY));
+            entities.push_back({
+                SceneEntityKind::Obstacle,
+                texture < 5 ? "obstacles" + std::to_string(texture + 2) + "-texture" : "tree" + std::to_string(texture - 4) + "-texture",
+                position,
+                glm::vec2(0),
+                0.0,
+                glm::vec2(0),
+                0
+            });
+        }
+        return entities;
+    }
+
+    std::string ToLuaString(const std::string& value)
+    {
+        std::string quoted = "\"";
+        for (char c : value)
+        {
+            if (c == '"' || c == '\\')
+                quoted += '\\';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    void WriteEntity(std::ostream& stream, const SceneEntity& entity)
+    {
+        const bool isEnemy = entity.kind != SceneEntityKind::Obstacle;
+        stream << "        {\n";
+        stream << "            group = " << (isEnemy ? "\"enemies\"" : "\"obstacles\"") << ",\n";
+        stream << "            components = {\n";
+        stream << "                transform = { position = { x = " << entity.position.x << ", y = " << entity.position.y << " }, scale = { x = 1.0, y = 1.0 }, rotation = " << entity.rotation << " },\n";
+        if (isEnemy)
+            stream << "                rigidbody = { velocity = { x = " << entity.velocity.x << ", y = " << entity.velocity.y << " } },\n";
+        stream << "                sprite = { texture_asset_id = " << ToLuaString(entity.textureAssetId) << ", width = 32, height = 32, z_index = " << (entity.kind == SceneEntityKind::Plane ? 5 : 2) << " },\n";
+        if (entity.kind == SceneEntityKind::Plane)
+            stream << "                animation = { num_frames = 2, speed_rate = 10 },\n";
+        stream << "                boxcollider = { width = 32, height = 32 },\n";
+        if (isEnemy)
+            stream << "                health = { health_percentage = 100 },\n";
+        if (entity.kind == SceneEntityKind::Tank)
+        {
+            stream << "                projectile_emitter = { projectile_velocity = { x = " << entity.projectileVelocity.x << ", y = " << entity.projectileVelocity.y
+                << " }, projectile_duration = 3, repeat_frequency = " << entity.repeatFrequency << ", hit_percentage_damage = 10, friendly = false },\n";
+        }
+        if (entity.kind == SceneEntityKind::Plane)
+            stream << "                on_update_script = { [0] = stress_plane_update },\n";
+        stream << "            }\n";
+        stream << "        },\n";
+    }
+}
+
+bool StressSceneGenerator::WriteLevel(const StressSceneSettings& settings, const std::string& scriptPath)
+{
+    const auto extension = scriptPath.find_last_of('.');
+    const std::string mapPath = (extension == std::string::npos ? scriptPath : scriptPath.substr(0, extension)) + ".map";
+
+    // Mostly sand, with some of the other ground tiles of desert.png. Written with '\n' on every platform,
+    // the level loader reads one character after each tile.
+    std::ofstream mapFile(mapPath, std::ios::trunc | std::ios::binary);
+    SceneRandom random(settings.seed);
+    const char* tiles[] = {"00", "00", "00", "00", "00", "00", "00", "21", "21", "11", "13"};
+    for (int row = 0; row < settings.mapNumRows; row++)
+    {
+        for (int col = 0; col < settings.mapNumCols; col++)
+        {
+            mapFile << tiles[random.Pick(11)] << (col + 1 < settings.mapNumCols ? ',' : '\n');
+        }
+    }
+    if (!mapFile)
+    {
+        Logger::Err("Failed to write the stress scene tilemap " + mapPath);
+        return false;
+    }
+
+    const float mapWidth = static_cast<float>(settings.mapNumCols * TILE_SIZE * TILE_SCALE);
+    const float mapHeight = static_cast<float>(settings.mapNumRows * TILE_SIZE * TILE_SCALE);
+    const auto entities = GenerateEntities(settings, mapWidth, mapHeight);
+
+    std::ofstream script(scriptPath, std::ios::trunc);
+    script << "-- Stress scene generated with seed " << settings.seed << ": " << settings.numTanks << " tanks, " << settings.numPlanes
+        << " planes, " << settings.numObstacles << " obstacles, " << settings.mapNumRows << "x" << settings.mapNumCols << " tiles\n";
+    script << PLANE_SCRIPT << "\n";
+    script << "Level = {\n";
+    script << "    assets = {\n";
+    script << "        [0] =\n";
+    script << "        { type = \"texture\", id = \"tilemap-texture\", file = \"./assets/tilemaps/desert.png\" },\n";
+    for (const char* model : {"panther", "tiger"})
+    {
+        for (const char* direction : {"up", "right", "down", "left"})
+        {
+            script << "        { type = \"texture\", id = \"tank-" << model << "-" << direction << "-texture\", file = \"./assets/images/tank-" << model << "-" << direction << ".png\" },\n";
+        }
+    }
+    script << "        { type = \"texture\", id = \"su27-texture\", file = \"./assets/images/su27-spritesheet.png\" },\n";
+    script << "        { type = \"texture\", id = \"f22-texture\", file = \"./assets/images/f22-spritesheet.png\" },\n";
+    for (int i = 2; i <= 6; i++)
+    {
+        script << "        { type = \"texture\", id = \"obstacles" << i << "-texture\", file = \"./assets/images/obstacles-" << i << ".png\" },\n";
+    }
+    for (int i = 1; i <= 9; i++)
+    {
+        script << "        { type = \"texture\", id = \"tree" << i << "-texture\", file = \"./assets/images/tree-" << i << ".png\" },\n";
+    }
+    script << "        { type = \"texture\", id = \"bullet-texture\", file = \"./assets/images/bullet.png\" },\n";
+    script << "        { type = \"font\", id = \"pico8-font-5\", file = \"./assets/fonts/pico8.ttf\", font_size = 5 }\n";
+    script << "    },\n";
+    script << "    tilemap = {\n";
+    script << "        map_file = " << ToLuaString(mapPath) << ",\n";
+    script << "        texture_asset_id = \"tilemap-texture\",\n";
+    script << "        num_rows = " << settings.mapNumRows << ",\n";
+    script << "        num_cols = " << settings.mapNumCols << ",\n";
+    script << "        tile_size = " << TILE_SIZE << ",\n";
+    script << "        scale = " << TILE_SCALE << "\n";
+    script << "    },\n";
+    script << "    entities = {\n";
+    script << "        [0] =\n";
+    for (const auto& entity : entities)
+    {
+        WriteEntity(script, entity);
+    }
+    script << "    }\n";
+    script << "}\n\n";
+    script << "map_width = Level.tilemap.num_cols * Level.tilemap.tile_size * Level.tilemap.scale\n";
+    script << "map_height = Level.tilemap.num_rows * Level.tilemap.tile_size * Level.tilemap.scale\n";
+
+    if (!script)
+    {
+        Logger::Err("Failed to write the stress scene level " + scriptPath);
+        return false;
+    }
+    Logger::Log("Stress scene with " + std::to_string(entities.size()) + " entities written to " + scriptPath);
+    return true;
+}
+
+void StressSceneGenerator::Spawn(const StressSceneSettings& settings, const std::unique_ptr<Registry>& registry, sol::state& lua)
+{
+    sol::function planeUpdate = lua["stress_plane_update"];
+    if (!planeUpdate.valid())
+    {
+        // Named after its own text, as luaL_loadstring does, so snapshots can save the function's source
+        lua.script(PLANE_SCRIPT, PLANE_SCRIPT);
+        planeUpdate = lua["stress_plane_update"];
+    }
+
+    const auto entities = GenerateEntities(settings, static_cast<float>(Game::mapWidth), static_cast<float>(Game::mapHeight));
+    for (const auto& sceneEntity : entities)
+    {
+        const bool isEnemy = sceneEntity.kind != SceneEntityKind::Obstacle;
+        Entity entity = registry->CreateEntity();
+        entity.Group(isEnemy ? "enemies" : "obstacles");
+        entity.AddComponent<TransformComponent>(sceneEntity.position, glm::vec2(1, 1), sceneEntity.rotation);
+        entity.AddComponent<SpriteComponent>(sceneEntity.textureAssetId, ENTITY_SIZE, ENTITY_SIZE, sceneEntity.kind == SceneEntityKind::Plane ? 5 : 2);
+        entity.AddComponent<BoxColliderComponent>(ENTITY_SIZE, ENTITY_SIZE);
+        if (isEnemy)
+        {
+            entity.AddComponent<RigidBodyComponent>(sceneEntity.velocity);
+            entity.AddComponent<HealthComponent>(100);
+        }
+        if (sceneEntity.kind == SceneEntityKind::Tank)
+            entity.AddComponent<ProjectileEmitterComponent>(sceneEntity.projectileVelocity, sceneEntity.repeatFrequency * 1000, 3000, 10, false);
+        if (sceneEntity.kind == SceneEntityKind::Plane)
+        {
+            entity.AddComponent<AnimationComponent>(2, 10);
+            entity.AddComponent<ScriptComponent>(planeUpdate);
+        }
+    }
+    Logger::Log("Spawned a stress scene with " + std::to_string(entities.size()) + " entities");
+}
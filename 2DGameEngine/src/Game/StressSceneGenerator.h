@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <sol/sol.hpp>
+
+class Registry;
+
+struct StressSceneSettings
+{
+    // Same seed and settings, same scene
+    unsigned int seed = 1;
+
+    // Enemies driving around and firing with a ProjectileEmitterComponent
+    int numTanks = 200;
+
+    // Enemies flying around the map, moved by a Lua on_update_script
+    int numPlanes = 100;
+
+    // Static colliders in the "obstacles" group, the tanks bounce off them
+    int numObstacles = 1000;
+
+    // Size of the generated tilemap in tiles (32px tiles drawn at scale 2)
+    int mapNumRows = 100;
+    int mapNumCols = 100;
+};
+
+/**
+ * @name StressSceneGenerator
+ * @brief Generates reproducible scenes with many more entities than the hand-written levels,
+ * to load the collision, render and script systems at production-like densities.
+ * A scene is either written as a level script (loaded with --level like Level1.lua/Level2.lua),
+ * or spawned in the running level from the debug GUI.
+ */
+class StressSceneGenerator
+{
+public:
+    // Writes the level script and its tilemap next to it (same path with the .map extension)
+    static bool WriteLevel(const StressSceneSettings& settings, const std::string& scriptPath);
+
+    // Adds the tanks, planes and obstacles of the scene to the current map. The tilemap size is ignored,
+    // and the textures must already be in the asset store (the ones of Level2.lua).
+    static void Spawn(const StressSceneSettings& settings, const std::unique_ptr<Registry>& registry, sol::state& lua);
+};
@@ -0,0 +1,208 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Job system and queue of the worker running on this thread, none for the other threads
+    thread_local const JobSystem* currentJobSystem = nullptr;
+    thread_local int currentQueueIndex = 0;
+}
+
+bool JobHandle::IsDone() const
+{
+    return !state || state->numPendingJobs.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem::JobSystem(int numWorkers)
+{
+    if (numWorkers < 0)
+        numWorkers = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 0);
+
+    numQueues = numWorkers + 1;
+    queues = std::make_unique<Queue[]>(numQueues);
+
+    workers.reserve(numWorkers);
+    for (int i = 0; i < numWorkers; i++)
+    {
+        workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        isStopping = true;
+    }
+    sleepCondition.notify_all();
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+int JobSystem::GetCurrentQueueIndex() const
+{
+    return currentJobSystem == this ? currentQueueIndex : 0;
+}
+
+void JobSystem::Push(Job job)
+{
+    Queue& queue = queues[GetCurrentQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+
+    // Taking the sleep mutex orders the push with a worker about to go to sleep, so the wake up isn't lost
+    numQueuedJobs.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    sleepCondition.notify_one();
+}
+
+bool JobSystem::TryPop(int queueIndex, Job& job)
+{
+    Queue& queue = queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty())
+        return false;
+
+    // The newest job of its own queue is the most likely to still be in the cache
+    job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool JobSystem::TrySteal(int thiefIndex, Job& job)
+{
+    for (int i = 1; i < numQueues; i++)
+    {
+        Queue& queue = queues[(thiefIndex + i) % numQueues];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+            continue;
+
+        // Steal from the other end, the oldest jobs are usually the biggest pieces of work left
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+        numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::TryRunJob()
+{
+    const int queueIndex = GetCurrentQueueIndex();
+
+    Job job;
+    if (!TryPop(queueIndex, job) && !TrySteal(queueIndex, job))
+        return false;
+
+    Run(job);
+    return true;
+}
+
+void JobSystem::Run(Job& job)
+{
+    job.function();
+
+    auto& state = *job.state;
+    if (state.numPendingJobs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+
+    // Last job of the handle: release the continuations waiting on it
+    std::vector<std::pair<std::function<void()>, std::shared_ptr<JobHandle::State>>> continuations;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.isDone = true;
+        continuations.swap(state.continuations);
+    }
+    for (auto& continuation : continuations)
+    {
+        Push({std::move(continuation.first), std::move(continuation.second)});
+    }
+}
+
+void JobSystem::WorkerLoop(int queueIndex)
+{
+    currentJobSystem = this;
+    currentQueueIndex = queueIndex;
+
+    while (true)
+    {
+        if (TryRunJob())
+            continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [this]() { return isStopping || numQueuedJobs.load(std::memory_order_acquire) > 0; });
+        if (isStopping)
+            return;
+    }
+}
+
+JobHandle JobSystem::Schedule(std::function<void()> job)
+{
+    auto state = std::make_shared<JobHandle::State>();
+    state->numPendingJobs = 1;
+    Push({std::move(job), state});
+    return JobHandle(state);
+}
+
+JobHandle JobSystem::Then(const JobHandle& handle, std::function<void()> job)
+{
+    auto state = std::make_shared<JobHandle::State>();
+    state->numPendingJobs = 1;
+
+    if (handle.state)
+    {
+        std::lock_guard<std::mutex> lock(handle.state->mutex);
+        if (!handle.state->isDone)
+        {
+            handle.state->continuations.emplace_back(std::move(job), state);
+            return JobHandle(state);
+        }
+    }
+
+    Push({std::move(job), state});
+    return JobHandle(state);
+}
+
+void JobSystem::Wait(const JobHandle& handle)
+{
+    while (!handle.IsDone())
+    {
+        if (!TryRunJob())
+            std::this_thread::yield();
+    }
+}
+
+JobHandle JobSystem::ParallelFor(int count, int batchSize, std::function<void(int begin, int end)> function)
+{
+    if (count <= 0)
+        return JobHandle();
+
+    batchSize = std::max(batchSize, 1);
+    const int numBatches = (count + batchSize - 1) / batchSize;
+    if (numBatches == 1)
+    {
+        function(0, count);
+        return JobHandle();
+    }
+
+    // Every batch shares the same function and the same handle
+    auto sharedFunction = std::make_shared<std::function<void(int, int)>>(std::move(function));
+    auto state = std::make_shared<JobHandle::State>();
+    state->numPendingJobs = numBatches;
+    for (int begin = 0; begin < count; begin += batchSize)
+    {
+        const int end = std::min(begin + batchSize, count);
+        Push({[sharedFunction, begin, end]() { (*sharedFunction)(begin, end); }, state});
+    }
+    return JobHandle(state);
+}
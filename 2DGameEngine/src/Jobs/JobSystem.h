@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+/**
+ * @name JobHandle
+ * @brief Tracks a scheduled job (or all the batches of a ParallelFor). Copies share the same state.
+ * A default constructed handle counts as already done.
+ */
+class JobHandle
+{
+public:
+    JobHandle() = default;
+
+    bool IsDone() const;
+
+private:
+    struct State
+    {
+        // Jobs of the handle that haven't finished yet
+        std::atomic<int> numPendingJobs{0};
+
+        // Guards isDone and continuations, so a continuation is never added after they were scheduled
+        std::mutex mutex;
+        bool isDone = false;
+        std::vector<std::pair<std::function<void()>, std::shared_ptr<State>>> continuations;
+    };
+
+    std::shared_ptr<State> state;
+
+    JobHandle(std::shared_ptr<State> state) : state(std::move(state)) {}
+
+    friend class JobSystem;
+};
+
+/**
+ * @name JobSystem
+ * @brief A pool of worker threads with one job queue per thread. Workers take the newest jobs of their
+ * own queue first and steal the oldest jobs of the other queues when it is empty, so work spreads to
+ * idle threads on its own. A thread that waits on a handle runs queued jobs in the meantime, so jobs
+ * can schedule and wait for other jobs, and a system without workers still completes everything.
+ * Jobs must not use the Logger or the registry structure (create, kill, add/remove components).
+ * Every scheduled job must be waited on before the job system is destroyed.
+ */
+class JobSystem
+{
+public:
+    // Typical size of a cache line, batches of ParallelFor are multiples of it
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    // By default one worker is started per hardware thread, minus the thread that owns the job system
+    JobSystem(int numWorkers = -1);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator =(const JobSystem&) = delete;
+
+    // Number of threads running jobs: the workers plus the thread waiting on them
+    int GetNumThreads() const { return static_cast<int>(workers.size()) + 1; }
+
+    JobHandle Schedule(std::function<void()> job);
+
+    // Schedules the job once every job of the given handle is done
+    JobHandle Then(const JobHandle& handle, std::function<void()> job);
+
+    // Runs queued jobs on the calling thread until every job of the handle is done
+    void Wait(const JobHandle& handle);
+
+    // Calls function(begin, end) for consecutive batches of batchSize indices covering [0, count).
+    // The batch index is begin / batchSize. A single batch runs right away on the calling thread.
+    JobHandle ParallelFor(int count, int batchSize, std::function<void(int begin, int end)> function);
+
+    // Smallest batch of at least minBatchSize elements of TElement that spans whole cache lines, so
+    // batches writing to a dense array never share a cache line with their neighbours
+    template <typename TElement> static int GetBatchSize(int minBatchSize);
+
+private:
+    struct Job
+    {
+        std::function<void()> function;
+        std::shared_ptr<JobHandle::State> state;
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    // queues[0] is shared by the threads outside the job system, queues[i + 1] belongs to workers[i]
+    std::unique_ptr<Queue[]> queues;
+    int numQueues = 0;
+    std::vector<std::thread> workers;
+
+    // Idle workers sleep until a job is pushed
+    std::atomic<int> numQueuedJobs{0};
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    bool isStopping = false;
+
+    void Push(Job job);
+    bool TryPop(int queueIndex, Job& job);
+    bool TrySteal(int thiefIndex, Job& job);
+    bool TryRunJob();
+    void Run(Job& job);
+    void WorkerLoop(int queueIndex);
+    int GetCurrentQueueIndex() const;
+};
+
+template <typename TElement>
+int JobSystem::GetBatchSize(int minBatchSize)
+{
+    // Number of elements after which the batch ends on a cache line boundary again
+    const int elementsPerLine = static_cast<int>(CACHE_LINE_SIZE / std::gcd(CACHE_LINE_SIZE, sizeof(TElement)));
+    const int numLines = (std::max(minBatchSize, 1) + elementsPerLine - 1) / elementsPerLine;
+    return numLines * elementsPerLine;
+}
@@ -4,10 +4,32 @@
 
 #include <iostream>
 #include <chrono>
+#include <cstdlib>
 #include <ctime>
 
 std::vector<LogEntry> Logger::messages;
 
+static bool isPrintingToStandardError = false;
+
+void Logger::SetPrintToStandardError(bool printToStandardError)
+{
+    isPrintingToStandardError = printToStandardError;
+}
+
+static std::ostream& GetOutput()
+{
+    return isPrintingToStandardError ? std::cerr : std::cout;
+}
+
+// Just because Rider doesn't start in Color mode by default. Runs a shell, so only once, before the first message.
+static void EnableConsoleColors()
+{
+#ifdef _WIN32
+    static const int result = system("Color");
+    (void)result;
+#endif
+}
+
 std::string CurrentDateTimeToString()
 {
     std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
@@ -21,9 +43,9 @@ void Logger::Log(const std::string& message)
     LogEntry logEntry;
     logEntry.type = LOG_INFO;
     logEntry.message = "LOG: [" + CurrentDateTimeToString() + "] " + message;
-    system("Color"); // Just because Rider doesn't start in Color mode by default.
+    EnableConsoleColors();
     
-    std::cout << "\x1B[32m" << logEntry.message << "\033[0m" << '\n';
+    GetOutput() << "\x1B[32m" << logEntry.message << "\033[0m" << '\n';
 
     messages.push_back(logEntry);
 }
@@ -33,9 +55,9 @@ void Logger::Err(const std::string& message)
     LogEntry logEntry;
     logEntry.type = LOG_ERROR;
     logEntry.message = "ERR: [" + CurrentDateTimeToString() + "] " + message;
-    system("Color"); // Just because Rider doesn't start in Color mode by default.
+    EnableConsoleColors();
     
-    std::cout << "\x1B[91m" << logEntry.message << "\033[0m" << '\n';
+    GetOutput() << "\x1B[91m" << logEntry.message << "\033[0m" << '\n';
 
     messages.push_back(logEntry);
 }
@@ -19,6 +19,10 @@ class Logger
 {
 public:
     static std::vector<LogEntry> messages;
+
+    // Messages are printed to stdout, or to stderr when stdout carries something else (e.g. a benchmark report)
+    static void SetPrintToStandardError(bool printToStandardError);
+
     static void Log(const std::string& message);
     static void Err(const std::string& message);
 };
@@ -1,13 +1,92 @@
 
 #include "Game/Game.h"
+#include "Game/StressSceneGenerator.h"
+#include "Logger/Logger.h"
+
+#include <cstdlib>
+#include <string>
 
 int main(int argc, char* argv[])
 {
+    std::string snapshotToRestore;
+    std::string levelScript;
+    int numBenchmarkFrames = 0;
+    std::string benchmarkOutput = "benchmark.json";
+    std::string stressScenePath;
+    StressSceneSettings stressScene;
+
+    for (int i = 1; i < argc; i++)
+    {
+        // --restore <file> starts from a snapshot saved with F5 instead of the level
+        if (std::string(argv[i]) == "--restore" && i + 1 < argc)
+        {
+            snapshotToRestore = argv[++i];
+        }
+        // --level <file> loads another Lua level script
+        else if (std::string(argv[i]) == "--level" && i + 1 < argc)
+        {
+            levelScript = argv[++i];
+        }
+        // --benchmark <frames> [--output <file>] runs headless and writes the system timings as JSON
+        else if (std::string(argv[i]) == "--benchmark" && i + 1 < argc)
+        {
+            numBenchmarkFrames = std::atoi(argv[++i]);
+        }
+        else if (std::string(argv[i]) == "--output" && i + 1 < argc)
+        {
+            benchmarkOutput = argv[++i];
+        }
+        // --generate-scene <file> writes a stress scene level and plays it, the options below configure it
+        else if (std::string(argv[i]) == "--generate-scene" && i + 1 < argc)
+        {
+            stressScenePath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--seed" && i + 1 < argc)
+        {
+            stressScene.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::string(argv[i]) == "--tanks" && i + 1 < argc)
+        {
+            stressScene.numTanks = std::atoi(argv[++i]);
+        }
+        else if (std::string(argv[i]) == "--planes" && i + 1 < argc)
+        {
+            stressScene.numPlanes = std::atoi(argv[++i]);
+        }
+        else if (std::string(argv[i]) == "--obstacles" && i + 1 < argc)
+        {
+            stressScene.numObstacles = std::atoi(argv[++i]);
+        }
+        else if (std::string(argv[i]) == "--map-size" && i + 2 < argc)
+        {
+            stressScene.mapNumRows = std::atoi(argv[++i]);
+            stressScene.mapNumCols = std::atoi(argv[++i]);
+        }
+    }
+
+    // Benchmarks keep stdout for the report, from the first message on
+    if (numBenchmarkFrames > 0)
+        Logger::SetPrintToStandardError(true);
+
+    if (!stressScenePath.empty())
+    {
+        if (!StressSceneGenerator::WriteLevel(stressScene, stressScenePath))
+            return 1;
+        levelScript = stressScenePath;
+    }
+
     Game game;
+    if (!snapshotToRestore.empty())
+        game.SetSnapshotToRestore(snapshotToRestore);
+    if (!levelScript.empty())
+        game.SetLevelScript(levelScript);
+    if (numBenchmarkFrames > 0)
+        game.SetBenchmark(numBenchmarkFrames, benchmarkOutput);
 
     game.Initialize();
-    game.Run();
+    const bool isSuccess = game.Run();
     game.Destroy();
     
-    return 0;
+    // Non-zero for scripts (e.g. a benchmark job) when the level failed to load or the benchmark didn't complete
+    return isSuccess ? 0 : 1;
 }
@@ -0,0 +1,213 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#include "../Logger/Logger.h"
+
+namespace
+{
+    struct ZoneEvent
+    {
+        const char* name;
+        std::uint64_t start;
+        std::uint64_t end;
+        int depth;
+        int threadIndex;
+    };
+
+    // Ring buffer written by a single thread. numWritten only grows, entry i lives at i % ZONES_PER_THREAD.
+    struct ThreadZones
+    {
+        std::array<ZoneEvent, Profiler::ZONES_PER_THREAD> zones;
+        std::atomic<std::uint64_t> numWritten{0};
+        int threadIndex = 0;
+    };
+
+    struct FrameTiming
+    {
+        std::uint64_t start;
+        std::uint64_t end;
+    };
+
+    // Buffers are never freed, so zones of threads that already exited can still be exported
+    std::mutex threadZonesMutex;
+    std::vector<std::unique_ptr<ThreadZones>> allThreadZones;
+
+    thread_local ThreadZones* currentThreadZones = nullptr;
+    thread_local int currentDepth = 0;
+
+    // Written by the main thread only
+    std::array<FrameTiming, Profiler::MAX_FRAMES> frames;
+    int numFrames = 0;
+    std::uint64_t currentFrameStart = 0;
+
+    ThreadZones& GetThreadZones()
+    {
+        if (!currentThreadZones)
+        {
+            std::lock_guard<std::mutex> lock(threadZonesMutex);
+            allThreadZones.push_back(std::make_unique<ThreadZones>());
+            allThreadZones.back()->threadIndex = static_cast<int>(allThreadZones.size()) - 1;
+            currentThreadZones = allThreadZones.back().get();
+        }
+        return *currentThreadZones;
+    }
+
+    // Copies the zones of every thread that ended after the given time
+    std::vector<ZoneEvent> CollectZones(std::uint64_t since)
+    {
+        std::vector<ZoneEvent> collected;
+
+        std::lock_guard<std::mutex> lock(threadZonesMutex);
+        for (const auto& threadZones : allThreadZones)
+        {
+            const std::uint64_t end = threadZones->numWritten.load(std::memory_order_acquire);
+            const std::uint64_t begin = end > Profiler::ZONES_PER_THREAD ? end - Profiler::ZONES_PER_THREAD : 0;
+
+            std::vector<ZoneEvent> copied;
+            for (std::uint64_t i = begin; i < end; i++)
+            {
+                copied.push_back(threadZones->zones[i % Profiler::ZONES_PER_THREAD]);
+            }
+
+            // Entries the thread wrote again while they were copied are dropped
+            const std::uint64_t endAfterCopy = threadZones->numWritten.load(std::memory_order_acquire);
+            const std::uint64_t firstValid = endAfterCopy > Profiler::ZONES_PER_THREAD ? endAfterCopy - Profiler::ZONES_PER_THREAD : 0;
+            for (std::uint64_t i = std::max(begin, firstValid); i < end; i++)
+            {
+                if (copied[i - begin].end >= since)
+                    collected.push_back(copied[i - begin]);
+            }
+        }
+        return collected;
+    }
+
+    const FrameTiming& GetFrame(int framesAgo)
+    {
+        return frames[(numFrames - 1 - framesAgo) % Profiler::MAX_FRAMES];
+    }
+}
+
+std::uint64_t Profiler::Now()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Profiler::RecordZone(const char* name, std::uint64_t start, std::uint64_t end, int depth)
+{
+    ThreadZones& threadZones = GetThreadZones();
+    const std::uint64_t index = threadZones.numWritten.load(std::memory_order_relaxed);
+    threadZones.zones[index % ZONES_PER_THREAD] = {name, start, end, depth, threadZones.threadIndex};
+    threadZones.numWritten.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::BeginFrame()
+{
+    currentFrameStart = Now();
+}
+
+void Profiler::EndFrame()
+{
+    frames[numFrames % MAX_FRAMES] = {currentFrameStart, Now()};
+    numFrames++;
+}
+
+std::vector<float> Profiler::GetFrameTimes()
+{
+    std::vector<float> frameTimes;
+    for (int framesAgo = std::min(numFrames, MAX_FRAMES) - 1; framesAgo >= 0; framesAgo--)
+    {
+        const auto& frame = GetFrame(framesAgo);
+        frameTimes.push_back(static_cast<float>((frame.end - frame.start) / 1000000.0));
+    }
+    return frameTimes;
+}
+
+std::vector<ProfileZoneSummary> Profiler::GetLastFrameZones()
+{
+    std::vector<ProfileZoneSummary> summaries;
+    if (numFrames == 0)
+        return summaries;
+
+    const auto& frame = GetFrame(0);
+    auto zones = CollectZones(frame.start);
+    std::sort(zones.begin(), zones.end(), [](const ZoneEvent& a, const ZoneEvent& b) { return a.start < b.start; });
+
+    for (const auto& zone : zones)
+    {
+        if (zone.start < frame.start || zone.end > frame.end)
+            continue;
+
+        const double milliseconds = (zone.end - zone.start) / 1000000.0;
+        auto summary = std::find_if(summaries.begin(), summaries.end(), [&zone](const ProfileZoneSummary& summary) {
+            return summary.name == zone.name && summary.depth == zone.depth;
+        });
+        if (summary != summaries.end())
+            summary->milliseconds += milliseconds;
+        else
+            summaries.push_back({zone.name, zone.depth, milliseconds});
+    }
+    return summaries;
+}
+
+bool Profiler::ExportTrace(const std::string& filePath, int numFramesToExport)
+{
+    numFramesToExport = std::min({numFramesToExport, numFrames, MAX_FRAMES});
+    if (numFramesToExport <= 0)
+    {
+        Logger::Err("No profiled frame to export");
+        return false;
+    }
+
+    std::ofstream file(filePath, std::ios::trunc);
+    if (!file)
+    {
+        Logger::Err("Cannot open trace file " + filePath);
+        return false;
+    }
+
+    const std::uint64_t since = GetFrame(numFramesToExport - 1).start;
+    const auto zones = CollectZones(since);
+
+    // Complete events ("X") in microseconds, one trace thread per profiled thread, plus a track for the frames
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1000,\"args\":{\"name\":\"Frames\"}}";
+    for (int framesAgo = numFramesToExport - 1; framesAgo >= 0; framesAgo--)
+    {
+        const auto& frame = GetFrame(framesAgo);
+        file << ",\n{\"name\":\"Frame\",\"ph\":\"X\",\"pid\":0,\"tid\":1000,\"ts\":" << (frame.start - since) / 1000.0
+            << ",\"dur\":" << (frame.end - frame.start) / 1000.0 << "}";
+    }
+    for (const auto& zone : zones)
+    {
+        if (zone.start < since)
+            continue;
+        file << ",\n{\"name\":\"" << zone.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << zone.threadIndex
+            << ",\"ts\":" << (zone.start - since) / 1000.0 << ",\"dur\":" << (zone.end - zone.start) / 1000.0 << "}";
+    }
+    file << "\n]}\n";
+
+    if (!file)
+    {
+        Logger::Err("Failed to write trace file " + filePath);
+        return false;
+    }
+    Logger::Log("Exported " + std::to_string(numFramesToExport) + " profiled frames to " + filePath);
+    return true;
+}
+
+ProfileZone::ProfileZone(const char* name) : name(name), start(Profiler::Now()), depth(currentDepth++)
+{
+}
+
+ProfileZone::~ProfileZone()
+{
+    currentDepth--;
+    Profiler::RecordZone(name, start, Profiler::Now(), depth);
+}
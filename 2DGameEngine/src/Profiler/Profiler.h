@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Zones compile to nothing when the profiler is disabled (build with ENABLE_PROFILER=0)
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER 1
+#endif
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if ENABLE_PROFILER
+// Times the rest of the enclosing scope. The name must outlive the profiler (a literal, or a string owned by a system).
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
+
+struct ProfileZoneSummary
+{
+    const char* name;
+    int depth;
+    double milliseconds;
+};
+
+/**
+ * @name Profiler
+ * @brief Collects timed zones from every thread plus the start and end of every frame.
+ * Each thread writes its zones to its own ring buffer without taking any lock, readers copy the buffers
+ * and drop the entries that were overwritten while they were reading. Only the last MAX_FRAMES frames
+ * and the last ZONES_PER_THREAD zones of each thread are kept.
+ * BeginFrame(), EndFrame() and the queries are meant to be called from the main thread.
+ */
+class Profiler
+{
+public:
+    static constexpr int MAX_FRAMES = 300;
+    static constexpr std::uint64_t ZONES_PER_THREAD = 1 << 14;
+
+    static void BeginFrame();
+    static void EndFrame();
+
+    // Duration of the last frames in milliseconds, oldest first
+    static std::vector<float> GetFrameTimes();
+
+    // Total time of every zone of the last complete frame, merged by name and depth, in the order they started
+    static std::vector<ProfileZoneSummary> GetLastFrameZones();
+
+    // Writes the zones of the last numFrames frames as a Chrome trace (chrome://tracing or ui.perfetto.dev)
+    static bool ExportTrace(const std::string& filePath, int numFrames);
+
+    // Used by ProfileZone
+    static std::uint64_t Now();
+    static void RecordZone(const char* name, std::uint64_t start, std::uint64_t end, int depth);
+};
+
+/**
+ * @name ProfileZone
+ * @brief Records the time between its construction and destruction as a zone of the current thread.
+ * Use it through the PROFILE_ZONE macro so it disappears when the profiler is disabled.
+ */
+class ProfileZone
+{
+public:
+    ProfileZone(const char* name);
+    ~ProfileZone();
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator =(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    std::uint64_t start;
+    int depth;
+};
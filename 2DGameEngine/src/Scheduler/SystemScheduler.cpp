@@ -0,0 +1,86 @@
+#include "SystemScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "../Profiler/Profiler.h"
+
+namespace
+{
+    double MillisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+SystemScheduler::SystemScheduler(Registry& registry, JobSystem& jobSystem) : registry(registry), jobSystem(jobSystem)
+{
+}
+
+bool SystemScheduler::Conflict(const System& a, const System& b)
+{
+    if (a.IsExclusive() || b.IsExclusive())
+        return true;
+
+    return (a.GetWriteSignature() & (b.GetReadSignature() | b.GetWriteSignature())).any()
+        || (b.GetWriteSignature() & a.GetReadSignature()).any();
+}
+
+void SystemScheduler::AddSystem(const std::string& name, const System& system, UpdateFunction update)
+{
+    // The step goes right after the last earlier step it conflicts with. An exclusive step conflicts
+    // with every step, so it always opens a new stage that no later step can join.
+    int stage = 0;
+    for (const auto& step : steps)
+    {
+        if (Conflict(*step.system, system))
+            stage = std::max(stage, step.stage + 1);
+    }
+
+    if (stage >= static_cast<int>(stages.size()))
+        stages.resize(stage + 1);
+    stages[stage].push_back(static_cast<int>(steps.size()));
+
+    steps.push_back({name, &system, std::move(update), stage, 0.0});
+}
+
+void SystemScheduler::RunStep(int stepIndex)
+{
+    auto& step = steps[stepIndex];
+    PROFILE_ZONE(step.name.c_str());
+    const auto start = std::chrono::steady_clock::now();
+    step.update(*commandBuffers[stepIndex]);
+    step.lastDurationMs = MillisecondsSince(start);
+}
+
+void SystemScheduler::Run()
+{
+    PROFILE_ZONE("Systems");
+    const auto start = std::chrono::steady_clock::now();
+
+    commandBuffers.clear();
+    for (size_t i = 0; i < steps.size(); i++)
+    {
+        commandBuffers.push_back(&registry.CreateCommandBuffer());
+    }
+
+    std::vector<JobHandle> jobs;
+    for (const auto& stage : stages)
+    {
+        // Every step of the stage but the first is a job, the first one runs here
+        for (size_t i = 1; i < stage.size(); i++)
+        {
+            const int stepIndex = stage[i];
+            jobs.push_back(jobSystem.Schedule([this, stepIndex]() { RunStep(stepIndex); }));
+        }
+        RunStep(stage[0]);
+
+        for (const auto& job : jobs)
+        {
+            jobSystem.Wait(job);
+        }
+        jobs.clear();
+    }
+
+    lastDurationMs = MillisecondsSince(start);
+}
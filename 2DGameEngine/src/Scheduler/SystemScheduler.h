@@ -0,0 +1,63 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../ECS/ECS.h"
+#include "../Jobs/JobSystem.h"
+
+/**
+ * @name SystemScheduler
+ * @brief Runs the system updates of a frame, several at the same time when they don't conflict.
+ * Updates are added in the order they would run one after the other. Two updates conflict when one
+ * writes a component the other reads or writes (see System::ReadsComponent/WritesComponent), or when
+ * one of them is exclusive. Every update is placed in the first stage after all the earlier updates it
+ * conflicts with, then the stages run in order and the updates of a stage run in parallel.
+ * Conflicting updates always keep their order, so a frame gives the same result as running sequentially.
+ * Exclusive updates run alone on the calling thread, the others run as jobs of the JobSystem.
+ */
+class SystemScheduler
+{
+public:
+    // Each update gets its own command buffer. The buffers are created in the order the updates were
+    // added, so the structural changes they record are played back in a deterministic order.
+    typedef std::function<void(CommandBuffer& commands)> UpdateFunction;
+
+    struct Step
+    {
+        std::string name;
+        const System* system;
+        UpdateFunction update;
+        int stage;
+        double lastDurationMs;
+    };
+
+    SystemScheduler(Registry& registry, JobSystem& jobSystem);
+
+    // Steps must be added before the first Run(), the profiler keeps pointers to their names
+    void AddSystem(const std::string& name, const System& system, UpdateFunction update);
+
+    // Runs every update once, stage by stage
+    void Run();
+
+    const std::vector<Step>& GetSteps() const { return steps; }
+    int GetNumStages() const { return static_cast<int>(stages.size()); }
+    double GetLastDurationMs() const { return lastDurationMs; }
+
+private:
+    Registry& registry;
+    JobSystem& jobSystem;
+    std::vector<Step> steps;
+
+    // Indices of the steps that run in each stage
+    std::vector<std::vector<int>> stages;
+
+    // Command buffer of every step for the current frame [Vector index = step index]
+    std::vector<CommandBuffer*> commandBuffers;
+
+    double lastDurationMs = 0.0;
+
+    static bool Conflict(const System& a, const System& b);
+    void RunStep(int stepIndex);
+};
@@ -0,0 +1,283 @@
+#include "Snapshot.h"
+
+#include <fstream>
+
+#include "../Logger/Logger.h"
+
+namespace
+{
+    const std::uint32_t SNAPSHOT_MAGIC = 0x53434553; // "SECS"
+    const std::uint32_t SNAPSHOT_VERSION = 5;
+}
+
+void SnapshotWriter::WriteString(const std::string& value)
+{
+    const std::uint32_t length = static_cast<std::uint32_t>(value.size());
+    Write(length);
+    WriteBytes(value.data(), length);
+}
+
+void SnapshotReader::ReadString(std::string& value)
+{
+    std::uint32_t length = 0;
+    Read(length);
+    if (!IsValid())
+        return;
+    value.resize(length);
+    ReadBytes(value.data(), length);
+}
+
+std::uint64_t SnapshotReader::GetRemainingSize()
+{
+    const auto position = stream.tellg();
+    if (position < 0)
+        return 0;
+    stream.seekg(0, std::ios::end);
+    const auto end = stream.tellg();
+    stream.seekg(position);
+    return end > position ? static_cast<std::uint64_t>(end - position) : 0;
+}
+
+void Snapshot::RegisterSection(const std::string& name, std::function<void(SnapshotWriter&)> write, std::function<void(SnapshotReader&)> read)
+{
+    sections.push_back({
+        name,
+        [write](const Registry&, SnapshotWriter& writer) { write(writer); },
+        [read](Registry&, SnapshotReader& reader) { read(reader); return reader.IsValid(); }
+    });
+}
+
+bool Snapshot::Save(const Registry& registry, const std::string& filePath) const
+{
+    if (registry.storageMode != StorageMode::Pools)
+    {
+        Logger::Err("Snapshots can only be saved from a registry that stores its components in pools");
+        return false;
+    }
+
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        Logger::Err("Cannot open snapshot file " + filePath);
+        return false;
+    }
+    SnapshotWriter writer(file);
+
+    writer.Write(SNAPSHOT_MAGIC);
+    writer.Write(SNAPSHOT_VERSION);
+
+    // Entity slots
+    const std::int32_t numEntities = registry.numEntities;
+    writer.Write(numEntities);
+    writer.WriteBytes(registry.entityGenerations.data(), numEntities * sizeof(std::uint32_t));
+
+    const std::int32_t numFreeIds = static_cast<std::int32_t>(registry.freeIds.size());
+    writer.Write(numFreeIds);
+    for (int entityId : registry.freeIds)
+    {
+        writer.Write<std::int32_t>(entityId);
+    }
+
+    // Tags are saved by name, since tag ids depend on the order names were first used
+    std::vector<std::string> tagNames(Registry::tagIds.size());
+    for (const auto& tag : Registry::tagIds)
+    {
+        tagNames[tag.second] = tag.first;
+    }
+    std::int32_t numTaggedEntities = 0;
+    for (int entityId = 0; entityId < numEntities; entityId++)
+    {
+        if (registry.tagPerEntity[entityId] != -1)
+            numTaggedEntities++;
+    }
+    writer.Write(numTaggedEntities);
+    for (int entityId = 0; entityId < numEntities; entityId++)
+    {
+        if (registry.tagPerEntity[entityId] == -1)
+            continue;
+        writer.Write<std::int32_t>(entityId);
+        writer.WriteString(tagNames[registry.tagPerEntity[entityId]]);
+    }
+
+    // Groups are saved as one mask per entity, plus the name of every bit of the masks
+    std::vector<std::string> groupNames(Registry::groupIds.size());
+    for (const auto& group : Registry::groupIds)
+    {
+        groupNames[group.second] = group.first;
+    }
+    writer.Write<std::int32_t>(static_cast<std::int32_t>(groupNames.size()));
+    for (const auto& groupName : groupNames)
+    {
+        writer.WriteString(groupName);
+    }
+    for (int entityId = 0; entityId < numEntities; entityId++)
+    {
+        writer.Write<std::uint32_t>(static_cast<std::uint32_t>(registry.groupsPerEntity[entityId].to_ulong()));
+    }
+
+    // Component pools and extra sections, each prefixed by its size so unknown sections can be skipped
+    writer.Write<std::int32_t>(static_cast<std::int32_t>(sections.size()));
+    for (const auto& section : sections)
+    {
+        writer.WriteString(section.name);
+
+        const auto sizePosition = file.tellp();
+        writer.Write<std::uint64_t>(0);
+        section.write(registry, writer);
+        const auto endPosition = file.tellp();
+
+        file.seekp(sizePosition);
+        writer.Write<std::uint64_t>(static_cast<std::uint64_t>(endPosition - sizePosition) - sizeof(std::uint64_t));
+        file.seekp(endPosition);
+    }
+
+    if (!file)
+    {
+        Logger::Err("Failed to write snapshot file " + filePath);
+        return false;
+    }
+    Logger::Log("Snapshot saved to " + filePath + " (" + std::to_string(numEntities) + " entity slots)");
+    return true;
+}
+
+bool Snapshot::Load(Registry& registry, const std::string& filePath) const
+{
+    if (registry.storageMode != StorageMode::Pools || registry.numEntities != 0)
+    {
+        Logger::Err("Snapshots can only be loaded into an empty registry that stores its components in pools");
+        return false;
+    }
+
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file)
+    {
+        Logger::Err("Cannot open snapshot file " + filePath);
+        return false;
+    }
+    SnapshotReader reader(file);
+
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    reader.Read(magic);
+    reader.Read(version);
+    if (!reader.IsValid() || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION)
+    {
+        Logger::Err("The file " + filePath + " is not a supported snapshot");
+        return false;
+    }
+
+    // Entity slots, all the per-entity arrays are sized in one go
+    std::int32_t numEntities = 0;
+    reader.Read(numEntities);
+    if (!reader.IsValid() || numEntities < 0 || static_cast<std::uint64_t>(numEntities) * sizeof(std::uint32_t) > reader.GetRemainingSize())
+    {
+        Logger::Err("Corrupted snapshot file " + filePath);
+        return false;
+    }
+
+    // A broken file leaves the registry empty again, so the caller can fall back to loading the level
+    auto fail = [&registry](const std::string& message)
+    {
+        Logger::Err(message);
+        registry.numEntities = 0;
+        registry.componentPools.clear();
+        registry.entityComponentSignatures.clear();
+        registry.entitySystemSignatures.clear();
+        registry.isEntityPending.clear();
+        registry.tagPerEntity.clear();
+        registry.entityPerTag.clear();
+        registry.groupsPerEntity.clear();
+        registry.entityGenerations.clear();
+        registry.freeIds.clear();
+        return false;
+    };
+    registry.numEntities = numEntities;
+    registry.entityComponentSignatures.assign(numEntities, Signature());
+    registry.entitySystemSignatures.assign(numEntities, Signature());
+    registry.isEntityPending.assign(numEntities, false);
+    registry.tagPerEntity.assign(numEntities, -1);
+    registry.groupsPerEntity.assign(numEntities, GroupMask());
+    registry.entityGenerations.resize(numEntities);
+    reader.ReadBytes(registry.entityGenerations.data(), numEntities * sizeof(std::uint32_t));
+
+    std::int32_t numFreeIds = 0;
+    reader.Read(numFreeIds);
+    std::vector<bool> isFreeId(numEntities, false);
+    for (int i = 0; i < numFreeIds && reader.IsValid(); i++)
+    {
+        std::int32_t entityId = -1;
+        reader.Read(entityId);
+        if (!reader.IsValid() || entityId < 0 || entityId >= numEntities || isFreeId[entityId])
+            return fail("Corrupted snapshot file " + filePath);
+        registry.freeIds.push_back(entityId);
+        isFreeId[entityId] = true;
+    }
+
+    std::int32_t numTaggedEntities = 0;
+    reader.Read(numTaggedEntities);
+    for (int i = 0; i < numTaggedEntities && reader.IsValid(); i++)
+    {
+        std::int32_t entityId = -1;
+        std::string tag;
+        reader.Read(entityId);
+        reader.ReadString(tag);
+        if (entityId >= 0 && entityId < numEntities)
+            registry.TagEntity(Entity(entityId, registry.entityGenerations[entityId]), tag);
+    }
+
+    // Map the group bits of the file to the group ids of this run
+    std::int32_t numGroups = 0;
+    reader.Read(numGroups);
+    std::vector<GroupId> groupIds;
+    for (int i = 0; i < numGroups && reader.IsValid(); i++)
+    {
+        std::string group;
+        reader.ReadString(group);
+        groupIds.push_back(Registry::GetGroupId(group));
+    }
+    for (int entityId = 0; entityId < numEntities && reader.IsValid(); entityId++)
+    {
+        std::uint32_t groupMask = 0;
+        reader.Read(groupMask);
+        for (int bit = 0; bit < static_cast<int>(groupIds.size()); bit++)
+        {
+            if ((groupMask & (1u << bit)) && groupIds[bit] >= 0)
+                registry.groupsPerEntity[entityId].set(groupIds[bit]);
+        }
+    }
+
+    std::int32_t numSections = 0;
+    reader.Read(numSections);
+    for (int i = 0; i < numSections && reader.IsValid(); i++)
+    {
+        std::string name;
+        std::uint64_t size = 0;
+        reader.ReadString(name);
+        reader.Read(size);
+
+        auto section = std::find_if(sections.begin(), sections.end(), [&name](const Section& section) { return section.name == name; });
+        if (section == sections.end())
+        {
+            Logger::Err("Skipping unknown snapshot section " + name);
+            reader.Skip(size);
+            continue;
+        }
+        if (!section->read(registry, reader))
+            return fail("Corrupted snapshot section " + name + " in " + filePath);
+    }
+
+    if (!reader.IsValid())
+        return fail("Corrupted snapshot file " + filePath);
+
+    // Every slot that is not free holds a live entity, they join their systems at the next update
+    for (int entityId = 0; entityId < numEntities; entityId++)
+    {
+        if (isFreeId[entityId])
+            continue;
+        registry.entitiesToBeAdded.emplace_back(entityId, registry.entityGenerations[entityId]);
+        registry.isEntityPending[entityId] = true;
+    }
+
+    Logger::Log("Snapshot loaded from " + filePath + " (" + std::to_string(numEntities) + " entity slots)");
+    return true;
+}
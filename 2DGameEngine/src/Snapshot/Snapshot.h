@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../ECS/ECS.h"
+
+/**
+ * @name SnapshotWriter
+ * @brief Writes plain values, raw blocks and strings to a snapshot stream.
+ */
+class SnapshotWriter
+{
+public:
+    SnapshotWriter(std::ostream& stream) : stream(stream) {}
+
+    void WriteBytes(const void* bytes, size_t size) { stream.write(static_cast<const char*>(bytes), size); }
+    void WriteString(const std::string& value);
+
+    template <typename T>
+    void Write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written as raw bytes");
+        WriteBytes(&value, sizeof(T));
+    }
+
+private:
+    std::ostream& stream;
+};
+
+/**
+ * @name SnapshotReader
+ * @brief Reads back what a SnapshotWriter wrote. Reading past the end or a broken file turns IsValid() off.
+ */
+class SnapshotReader
+{
+public:
+    SnapshotReader(std::istream& stream) : stream(stream) {}
+
+    bool IsValid() const { return static_cast<bool>(stream); }
+    void ReadBytes(void* bytes, size_t size) { stream.read(static_cast<char*>(bytes), size); }
+    void Skip(std::uint64_t size) { stream.seekg(size, std::ios::cur); }
+    void ReadString(std::string& value);
+
+    // Bytes left until the end of the stream, so counts read from the file can be checked before allocating for them
+    std::uint64_t GetRemainingSize();
+
+    template <typename T>
+    void Read(T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read as raw bytes");
+        ReadBytes(&value, sizeof(T));
+    }
+
+private:
+    std::istream& stream;
+};
+
+/**
+ * @name Snapshot
+ * @brief Saves the whole registry (entity slots, free ids, tags, groups and every registered component pool)
+ * to a compact binary file, and restores it in one pass.
+ * Component ids depend on the order types are first used in a run, so every component type to save is
+ * registered with a stable name. Trivially copyable components are written as raw blocks, the others go
+ * through the write/read hooks given at registration. Components that are not registered are not saved.
+ * Extra state that is not part of the registry (assets, map size...) can be stored in named sections.
+ */
+class Snapshot
+{
+public:
+    template <typename TComponent>
+    using WriteFunction = std::function<void(SnapshotWriter& writer, const TComponent& component)>;
+    template <typename TComponent>
+    using ReadFunction = std::function<void(SnapshotReader& reader, TComponent& component)>;
+
+    // Components are read into default-constructed objects, so registered components must be default constructible
+    template <typename TComponent> void RegisterComponent(const std::string& name);
+    template <typename TComponent> void RegisterComponent(const std::string& name, WriteFunction<TComponent> write, ReadFunction<TComponent> read);
+
+    void RegisterSection(const std::string& name, std::function<void(SnapshotWriter&)> write, std::function<void(SnapshotReader&)> read);
+
+    // Only registries using StorageMode::Pools can be saved. Loading needs a registry without any entity,
+    // the restored entities join their systems at the next Registry::Update().
+    bool Save(const Registry& registry, const std::string& filePath) const;
+    bool Load(Registry& registry, const std::string& filePath) const;
+
+private:
+    struct Section
+    {
+        std::string name;
+        std::function<void(const Registry&, SnapshotWriter&)> write;
+        std::function<bool(Registry&, SnapshotReader&)> read;
+    };
+
+    std::vector<Section> sections;
+
+    template <typename TComponent>
+    static void WritePool(const Registry& registry, SnapshotWriter& writer, const WriteFunction<TComponent>& write);
+    template <typename TComponent>
+    static bool ReadPool(Registry& registry, SnapshotReader& reader, const ReadFunction<TComponent>& read);
+};
+
+template <typename TComponent>
+void Snapshot::RegisterComponent(const std::string& name)
+{
+    static_assert(std::is_trivially_copyable_v<TComponent>, "Register a write and a read function for this component");
+    RegisterComponent<TComponent>(name, nullptr, nullptr);
+}
+
+template <typename TComponent>
+void Snapshot::RegisterComponent(const std::string& name, WriteFunction<TComponent> write, ReadFunction<TComponent> read)
+{
+    sections.push_back({
+        name,
+        [write](const Registry& registry, SnapshotWriter& writer) { WritePool<TComponent>(registry, writer, write); },
+        [read](Registry& registry, SnapshotReader& reader) { return ReadPool<TComponent>(registry, reader, read); }
+    });
+}
+
+template <typename TComponent>
+void Snapshot::WritePool(const Registry& registry, SnapshotWriter& writer, const WriteFunction<TComponent>& write)
+{
+    const auto componentId = Component<TComponent>::GetId();
+    const Pool<TComponent>* pool = componentId < static_cast<int>(registry.componentPools.size())
+        ? static_cast<const Pool<TComponent>*>(registry.componentPools[componentId].get())
+        : nullptr;
+
+    const std::int32_t count = pool ? pool->GetSize() : 0;
+    writer.Write(count);
+    if (count == 0)
+        return;
+
+    writer.WriteBytes(pool->GetEntityIds().data(), count * sizeof(int));
+    if (!write)
+    {
+        if constexpr (std::is_trivially_copyable_v<TComponent>)
+            writer.WriteBytes(pool->GetComponents().data(), count * sizeof(TComponent));
+        return;
+    }
+
+    for (const auto& component : pool->GetComponents())
+    {
+        write(writer, component);
+    }
+}
+
+template <typename TComponent>
+bool Snapshot::ReadPool(Registry& registry, SnapshotReader& reader, const ReadFunction<TComponent>& read)
+{
+    std::int32_t count = 0;
+    reader.Read(count);
+    if (!reader.IsValid() || count < 0 || count > registry.numEntities)
+        return false;
+    if (static_cast<std::uint64_t>(count) * sizeof(int) > reader.GetRemainingSize())
+        return false;
+
+    std::vector<int> entityIds(count);
+    reader.ReadBytes(entityIds.data(), count * sizeof(int));
+
+    std::vector<TComponent> components(count);
+    if (!read)
+    {
+        if constexpr (std::is_trivially_copyable_v<TComponent>)
+            reader.ReadBytes(components.data(), count * sizeof(TComponent));
+    }
+    else
+    {
+        for (auto& component : components)
+        {
+            read(reader, component);
+        }
+    }
+    if (!reader.IsValid())
+        return false;
+
+    // Every id must be a live slot that appears only once, the signatures are only set once they all are
+    const auto componentId = Component<TComponent>::GetId();
+    std::vector<bool> isTaken(registry.numEntities, false);
+    for (int entityId : registry.freeIds)
+    {
+        isTaken[entityId] = true;
+    }
+    for (int entityId : entityIds)
+    {
+        if (entityId < 0 || entityId >= registry.numEntities || isTaken[entityId])
+            return false;
+        isTaken[entityId] = true;
+    }
+    for (int entityId : entityIds)
+    {
+        registry.entityComponentSignatures[entityId].set(componentId);
+    }
+
+    registry.GetOrCreatePool<TComponent>()->Assign(std::move(entityIds), std::move(components), registry.changeTick);
+    return true;
+}
@@ -4,6 +4,7 @@
 
 #include "../Components/AnimationComponent.h"
 #include "../Components/SpriteComponent.h"
+#include "../Game/SimulationTime.h"
 #include "../ECS/ECS.h"
 
 class AnimationSystem : public System
@@ -13,17 +14,24 @@ public:
     {
         RequireComponent<SpriteComponent>();
         RequireComponent<AnimationComponent>();
+
+        WritesComponent<SpriteComponent>();
+        WritesComponent<AnimationComponent>();
     }
 
-    void Update()
+    void Update(const std::unique_ptr<Registry>& registry)
     {
-        for (auto entity : GetSystemEntities())
+        const int ticks = SimulationTime::GetTicks();
+        registry->View<const AnimationComponent, const SpriteComponent>().Each([ticks](Entity entity, const AnimationComponent& animation, const SpriteComponent& sprite)
         {
-            auto& animation = entity.GetComponent<AnimationComponent>();
-            auto& sprite = entity.GetComponent<SpriteComponent>();
+            const int currentFrame = (((ticks - animation.startTime) * animation.frameSpeedRate) / 1000) % animation.numFrames;
+
+            // Only write (and flag as changed) the components when the animation actually moves to another frame
+            if (currentFrame == animation.currentFrame && sprite.srcRect.x == currentFrame * sprite.width)
+                return;
 
-            animation.currentFrame = (((SDL_GetTicks() - animation.startTime) * animation.frameSpeedRate) / 1000) % animation.numFrames;
-            sprite.srcRect.x = animation.currentFrame * sprite.width;
-        }
+            entity.GetComponent<AnimationComponent>().currentFrame = currentFrame;
+            entity.GetComponent<SpriteComponent>().srcRect.x = currentFrame * sprite.width;
+        });
     }
 };
@@ -12,13 +12,16 @@ public:
     {
         RequireComponent<CameraFollowComponent>();
         RequireComponent<TransformComponent>();
+
+        // The camera rectangle is only touched by this system
+        ReadsComponent<TransformComponent>();
     }
 
     void Update(SDL_Rect& camera)
     {
         for (auto entity : GetSystemEntities())
         {
-            auto transform = entity.GetComponent<TransformComponent>();
+            const auto& transform = entity.GetComponent<const TransformComponent>();
 
             // Change camera.x and camera.y based on the entity transform position
             if (transform.position.x + (camera.w / 2) < Game::mapWidth)
@@ -3,60 +3,108 @@
 #include "../Components/BoxColliderComponent.h"
 #include "../Components/TransformComponent.h"
 #include "../Events/CollisionEvent.h"
+#include "../EventBus/EventBus.h"
 #include "../ECS/ECS.h"
+#include "../Jobs/JobSystem.h"
 
 class CollisionSystem : public System
 {
+private:
+    struct Collider
+    {
+        Entity entity;
+        double x;
+        double y;
+        double width;
+        double height;
+    };
+
+    // Reused every frame to avoid reallocating it
+    std::vector<Collider> colliders;
+
+    // Colliding pairs (indices in colliders) found by each ParallelFor batch
+    std::vector<std::vector<std::pair<int, int>>> collisionsPerBatch;
+
+    // Pairs tested and found colliding by the last Update()
+    std::int64_t numPairsTested = 0;
+    int numCollisions = 0;
+
 public:
     CollisionSystem()
     {
         RequireComponent<TransformComponent>();
         RequireComponent<BoxColliderComponent>();
+
+        // The collision queue is read by the systems that respond to the collisions, after this update
+        SetExclusive(true);
     }
 
-    void Update(std::unique_ptr<EventBus>& eventBus)
+    void Update(const std::unique_ptr<Registry>& registry, JobSystem& jobSystem, std::unique_ptr<EventBus>& eventBus)
     {
-        auto entities = GetSystemEntities();
+        // Gather the collision boxes once, so the pair loop below only touches this packed array.
+        colliders.clear();
+        registry->View<const TransformComponent, const BoxColliderComponent>().Each([this](Entity entity, const TransformComponent& transform, const BoxColliderComponent& collider)
+        {
+            colliders.push_back({
+                entity,
+                transform.position.x + collider.offset.x,
+                transform.position.y + collider.offset.y,
+                static_cast<double>(collider.width),
+                static_cast<double>(collider.height)
+            });
+        });
 
-        // Loop all the entities that the system is interested in.
-        for (auto i = entities.begin(); i != entities.end(); i++)
+        // Test the pairs on the job system. The first colliders have the most pairs to test, so batches are
+        // kept small for the idle threads to steal the rest.
+        const int numColliders = static_cast<int>(colliders.size());
+        const int batchSize = JobSystem::GetBatchSize<Collider>(32);
+        const int numBatches = (numColliders + batchSize - 1) / batchSize;
+        if (static_cast<int>(collisionsPerBatch.size()) < numBatches)
+            collisionsPerBatch.resize(numBatches);
+
+        jobSystem.Wait(jobSystem.ParallelFor(numColliders, batchSize, [&](int begin, int end)
         {
-            Entity a = *i;
-            auto aTransform = a.GetComponent<TransformComponent>();
-            auto aCollider = a.GetComponent<BoxColliderComponent>();
+            auto& collisions = collisionsPerBatch[begin / batchSize];
 
-            // Loop all the entities that still need to be checked (to the right of i).
-            for (auto j = i; j != entities.end(); j++)
+            // Loop all the entities that the system is interested in.
+            for (int i = begin; i < end; i++)
             {
-                Entity b = *j;
-
-                // Bypass if we're trying to test the same entity.
-                if (a == b) continue;
-                
-                auto bTransform = b.GetComponent<TransformComponent>();
-                auto bCollider = b.GetComponent<BoxColliderComponent>();
-
-                // Perform the AABB collision between the entities a and b.
-                bool isColliding = CheckAABBCollision(
-                    aTransform.position.x + aCollider.offset.x,
-                    aTransform.position.y + aCollider.offset.y,
-                    aCollider.width,
-                    aCollider.height,
-                    bTransform.position.x + bCollider.offset.x,
-                    bTransform.position.y + bCollider.offset.y,
-                    bCollider.width,
-                    bCollider.height
-                );
-
-                if (isColliding)
+                const Collider& a = colliders[i];
+
+                // Loop all the entities that still need to be checked (to the right of i).
+                for (int j = i + 1; j < numColliders; j++)
                 {
-                    // Emit an event
-                    eventBus->EmitEvent<CollisionEvent>(a, b);
+                    const Collider& b = colliders[j];
+
+                    // Perform the AABB collision between the entities a and b.
+                    bool isColliding = CheckAABBCollision(a.x, a.y, a.width, a.height, b.x, b.y, b.width, b.height);
+
+                    if (isColliding)
+                        collisions.emplace_back(i, j);
                 }
             }
+        }));
+
+        numPairsTested = static_cast<std::int64_t>(numColliders) * (numColliders - 1) / 2;
+        numCollisions = 0;
+
+        // Queue the events on this thread, in the same order as testing the pairs one by one. Nothing responds
+        // to them here, the DamageSystem and the MovementSystem read the whole queue in their own update.
+        auto& collisionQueue = eventBus->GetEventQueue<CollisionEvent>();
+        for (int batch = 0; batch < numBatches; batch++)
+        {
+            numCollisions += static_cast<int>(collisionsPerBatch[batch].size());
+            for (const auto& collision : collisionsPerBatch[batch])
+            {
+                collisionQueue.Push(colliders[collision.first].entity, colliders[collision.second].entity);
+            }
+            collisionsPerBatch[batch].clear();
         }
     }
 
+    std::int64_t GetNumPairsTested() const { return numPairsTested; }
+    int GetNumCollisions() const { return numCollisions; }
+
     bool CheckAABBCollision(double aX, double aY, double aW, double aH, double bX, double bY, double bW, double bH)
     {
         return
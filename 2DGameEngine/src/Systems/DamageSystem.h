@@ -9,46 +9,51 @@
 
 class DamageSystem : public System
 {
+private:
+    // Interned once, collisions are checked every frame
+    const TagId playerTag = Registry::GetTagId("player");
+    const GroupId projectilesGroup = Registry::GetGroupId("projectiles");
+    const GroupId enemiesGroup = Registry::GetGroupId("enemies");
+
 public:
     DamageSystem()
     {
         RequireComponent<BoxColliderComponent>();
-    }
 
-    void SubscribeToEvents(std::unique_ptr<EventBus>& eventBus)
-    {
-        eventBus->SubscribeToEvent<CollisionEvent>(this, &DamageSystem::OnCollision);
+        // Kills are recorded in the step's command buffer, so the update can run next to the other collision responses
+        WritesComponent<HealthComponent>();
+        ReadsComponent<ProjectileComponent>();
     }
 
-    void OnCollision(CollisionEvent& event)
+    void OnCollision(const CollisionEvent& event, CommandBuffer& commands)
     {
         Entity a = event.a;
         Entity b = event.b;
 
-        if (a.BelongsToGroup("projectiles") && b.HasTag("player"))
+        if (a.BelongsToGroup(projectilesGroup) && b.HasTag(playerTag))
         {
-            OnProjectileHitPlayer(a, b);
+            OnProjectileHitPlayer(a, b, commands);
         }
 
-        if (b.BelongsToGroup("projectiles") && a.HasTag("player"))
+        if (b.BelongsToGroup(projectilesGroup) && a.HasTag(playerTag))
         {
-            OnProjectileHitPlayer(b, a);
+            OnProjectileHitPlayer(b, a, commands);
         }
 
-        if (a.BelongsToGroup("projectiles") && b.BelongsToGroup("enemies"))
+        if (a.BelongsToGroup(projectilesGroup) && b.BelongsToGroup(enemiesGroup))
         {
-            OnProjectileHitEnemy(a, b);
+            OnProjectileHitEnemy(a, b, commands);
         }
 
-        if (b.BelongsToGroup("projectiles") && a.BelongsToGroup("enemies"))
+        if (b.BelongsToGroup(projectilesGroup) && a.BelongsToGroup(enemiesGroup))
         {
-            OnProjectileHitEnemy(b, a);
+            OnProjectileHitEnemy(b, a, commands);
         }
     }
 
-    void OnProjectileHitPlayer(Entity projectile, Entity player)
+    void OnProjectileHitPlayer(Entity projectile, Entity player, CommandBuffer& commands)
     {
-        auto projectileComponent = projectile.GetComponent<ProjectileComponent>();
+        const auto& projectileComponent = projectile.GetComponent<const ProjectileComponent>();
 
         if (!projectileComponent.isFriendly)
         {
@@ -60,17 +65,17 @@ public:
             // Kill the player when health reaches zero
             if (health.healthPercentage <= 0)
             {
-                player.Kill();
+                commands.KillEntity(player);
             }
 
             // Kill the projectile
-            projectile.Kill();
+            commands.KillEntity(projectile);
         }
     }
 
-    void OnProjectileHitEnemy(Entity projectile, Entity enemy)
+    void OnProjectileHitEnemy(Entity projectile, Entity enemy, CommandBuffer& commands)
     {
-        auto projectileComponent = projectile.GetComponent<ProjectileComponent>();
+        const auto& projectileComponent = projectile.GetComponent<const ProjectileComponent>();
 
         if (projectileComponent.isFriendly)
         {
@@ -82,16 +87,20 @@ public:
             // Kill the player when health reaches zero
             if (health.healthPercentage <= 0)
             {
-                enemy.Kill();
+                commands.KillEntity(enemy);
             }
 
             // Kill the projectile
-            projectile.Kill();
+            commands.KillEntity(projectile);
         }
     }
     
-    void Update()
+    // Responds to all the collisions queued by the CollisionSystem during this step
+    void Update(std::unique_ptr<EventBus>& eventBus, CommandBuffer& commands)
     {
-        
+        for (const auto& collision : eventBus->GetEventQueue<CollisionEvent>().GetEvents())
+        {
+            OnCollision(collision, commands);
+        }
     }
 };
@@ -9,6 +9,9 @@
 
 class KeyboardControlSystem : public System
 {
+private:
+    EventSubscription keyPressedSubscription;
+
 public:
     KeyboardControlSystem()
     {
@@ -19,14 +22,14 @@ public:
 
     void SubscribeToEvents(std::unique_ptr<EventBus>& eventBus)
     {
-        eventBus->SubscribeToEvent(this, &KeyboardControlSystem::OnKeyPress);
+        keyPressedSubscription = eventBus->SubscribeToEvent<&KeyboardControlSystem::OnKeyPress>(this);
     }
 
     void OnKeyPress(KeyPressedEvent& event)
     {
         for (auto entity : GetSystemEntities())
         {
-            const auto keyboardControl = entity.GetComponent<KeyboardControlledComponent>();
+            const auto& keyboardControl = entity.GetComponent<const KeyboardControlledComponent>();
             auto& sprite = entity.GetComponent<SpriteComponent>();
             auto& rigidBody = entity.GetComponent<RigidBodyComponent>();
 
@@ -1,36 +1,56 @@
 #pragma once
 
 #include "../ECS/ECS.h"
+#include "../Jobs/JobSystem.h"
 
 #include "../Components/TransformComponent.h"
 #include "../Components/RigidBodyComponent.h"
 #include "../Components/SpriteComponent.h"
 #include "../Events/CollisionEvent.h"
+#include "../EventBus/EventBus.h"
 
 class MovementSystem : public System
 {
+private:
+    // Interned once, these are checked for every collision and every moving entity
+    const TagId playerTag = Registry::GetTagId("player");
+    const GroupId enemiesGroup = Registry::GetGroupId("enemies");
+    const GroupId obstaclesGroup = Registry::GetGroupId("obstacles");
+
+    // Entities that left the map, one list per ParallelFor batch so batches never share a list
+    std::vector<std::vector<Entity>> entitiesOutsideMap;
+
 public:
     MovementSystem()
     {
         RequireComponent<TransformComponent>();
         RequireComponent<RigidBodyComponent>();
+
+        // The rigid bodies and sprites are only written by ProcessCollisions(), scheduled as its own step
+        WritesComponent<TransformComponent>();
+        WritesComponent<RigidBodyComponent>();
+        WritesComponent<SpriteComponent>();
     }
 
-    void SubscribeToEvents(const std::unique_ptr<EventBus>& eventBus)
+    // Bounces the enemies off the obstacles, for all the collisions queued by the CollisionSystem during this step
+    void ProcessCollisions(const std::unique_ptr<EventBus>& eventBus)
     {
-        eventBus->SubscribeToEvent<CollisionEvent>(this, &MovementSystem::OnCollision);
+        for (const auto& collision : eventBus->GetEventQueue<CollisionEvent>().GetEvents())
+        {
+            OnCollision(collision);
+        }
     }
 
-    void OnCollision(CollisionEvent& event)
+    void OnCollision(const CollisionEvent& event)
     {
         Entity a = event.a;
         Entity b = event.b;
 
-        if (a.BelongsToGroup("enemies") && b.BelongsToGroup("obstacles"))
+        if (a.BelongsToGroup(enemiesGroup) && b.BelongsToGroup(obstaclesGroup))
         {
             OnEnemyCollideWithObstacle(a, b);
         }
-        if (a.BelongsToGroup("obstacles") && b.BelongsToGroup("enemies"))
+        if (a.BelongsToGroup(obstaclesGroup) && b.BelongsToGroup(enemiesGroup))
         {
             OnEnemyCollideWithObstacle(b, a);
         }
@@ -56,52 +76,75 @@ public:
         }
     }
     
-    void Update(double deltaTime)
+    void Update(const std::unique_ptr<Registry>& registry, JobSystem& jobSystem, double deltaTime, CommandBuffer& commands)
     {
-        // Loop over all the entities that the system is interested in
-        for (auto entity : GetSystemEntities())
-        {
-            // Update entity position based on its velocity every frame of the game loop.
-            auto& transform = entity.GetComponent<TransformComponent>();
-            const auto rigidBody = entity.GetComponent<RigidBodyComponent>();
+        // Loop over all the entities that have a transform and a rigid body, in batches spread over the job system
+        const auto view = registry->View<TransformComponent, const RigidBodyComponent>();
+        const int batchSize = JobSystem::GetBatchSize<TransformComponent>(1024);
+        const int numBatches = (view.GetRangeSize() + batchSize - 1) / batchSize;
+        if (static_cast<int>(entitiesOutsideMap.size()) < numBatches)
+            entitiesOutsideMap.resize(numBatches);
 
-            transform.position.x += rigidBody.velocity.x * static_cast<float>(deltaTime);
-            transform.position.y += rigidBody.velocity.y * static_cast<float>(deltaTime);
-
-            // Check if entity is outside the map boundaries(with a 100 px forgiving margin)
-            const int margin = 100;
-            
-            bool isEntityOutsideMap = (
-                transform.position.x < -margin ||
-                transform.position.x > Game::mapWidth + margin ||
-                transform.position.y < -margin ||
-                transform.position.y > Game::mapHeight + margin
-            );
-
-            // Kill all entities that move outside the map boundaries
-            if (isEntityOutsideMap && !entity.HasTag("player"))
+        jobSystem.Wait(jobSystem.ParallelFor(view.GetRangeSize(), batchSize, [&](int begin, int end)
+        {
+            auto& batchEntitiesOutsideMap = entitiesOutsideMap[begin / batchSize];
+            view.Each(begin, end, [&](Entity entity, TransformComponent& transform, const RigidBodyComponent& rigidBody)
             {
-                entity.Kill();
-            }
+                MoveEntity(entity, transform, rigidBody, deltaTime, batchEntitiesOutsideMap);
+            });
+        }));
 
-            if (entity.HasTag("player") && entity.HasComponent<SpriteComponent>())
+        // Kill all entities that move outside the map boundaries, in the same order as a sequential loop
+        for (int batch = 0; batch < numBatches; batch++)
+        {
+            for (auto entity : entitiesOutsideMap[batch])
             {
-                const auto sprite = entity.GetComponent<SpriteComponent>();
-
-                const int paddingLeft = 0;
-                const int paddingRight = 0;
-                const int paddingTop = 0;
-                const int paddingBottom = 80;
-                
-                if (transform.position.x < 0 + paddingTop)
-                    transform.position.x = 0 + paddingTop;
-                if (transform.position.x > Game::mapWidth - sprite.width - paddingRight)
-                    transform.position.x = Game::mapWidth - sprite.width - paddingRight;
-                if (transform.position.y < 0 + paddingLeft)
-                    transform.position.y = 0 + paddingLeft;
-                if (transform.position.y > Game::mapHeight - sprite.height - paddingBottom)
-                    transform.position.y = Game::mapHeight - sprite.height - paddingBottom;
+                commands.KillEntity(entity);
             }
+            entitiesOutsideMap[batch].clear();
+        }
+    }
+
+private:
+    void MoveEntity(Entity entity, TransformComponent& transform, const RigidBodyComponent& rigidBody, double deltaTime, std::vector<Entity>& entitiesToKill) const
+    {
+        // Update entity position based on its velocity every frame of the game loop.
+        transform.position.x += rigidBody.velocity.x * static_cast<float>(deltaTime);
+        transform.position.y += rigidBody.velocity.y * static_cast<float>(deltaTime);
+
+        // Check if entity is outside the map boundaries(with a 100 px forgiving margin)
+        const int margin = 100;
+        
+        bool isEntityOutsideMap = (
+            transform.position.x < -margin ||
+            transform.position.x > Game::mapWidth + margin ||
+            transform.position.y < -margin ||
+            transform.position.y > Game::mapHeight + margin
+        );
+
+        // Entities that move outside the map boundaries are killed once every batch is done
+        if (isEntityOutsideMap && !entity.HasTag(playerTag))
+        {
+            entitiesToKill.push_back(entity);
+        }
+
+        if (entity.HasTag(playerTag) && entity.HasComponent<SpriteComponent>())
+        {
+            const auto& sprite = entity.GetComponent<const SpriteComponent>();
+
+            const int paddingLeft = 0;
+            const int paddingRight = 0;
+            const int paddingTop = 0;
+            const int paddingBottom = 80;
+            
+            if (transform.position.x < 0 + paddingTop)
+                transform.position.x = 0 + paddingTop;
+            if (transform.position.x > Game::mapWidth - sprite.width - paddingRight)
+                transform.position.x = Game::mapWidth - sprite.width - paddingRight;
+            if (transform.position.y < 0 + paddingLeft)
+                transform.position.y = 0 + paddingLeft;
+            if (transform.position.y > Game::mapHeight - sprite.height - paddingBottom)
+                transform.position.y = Game::mapHeight - sprite.height - paddingBottom;
         }
     }
 };
@@ -8,20 +8,60 @@
 #include "../Components/ProjectileComponent.h"
 #include "../Components/TransformComponent.h"
 #include "../Components/SpriteComponent.h"
+#include "../Game/SimulationTime.h"
+#include "../Events/KeyPressedEvent.h"
+#include "../EventBus/EventBus.h"
 #include "../ECS/ECS.h"
 
 class ProjectileEmitSystem : public System
 {
+private:
+    const TagId playerTag = Registry::GetTagId("player");
+
+    // Components shared by every projectile, the position, velocity and damage are set per shot
+    Prefab playerProjectilePrefab;
+    Prefab projectilePrefab;
+
+    EventSubscription keyPressedSubscription;
+
+    void SpawnProjectile(Registry& registry, const Prefab& prefab, glm::vec2 position, glm::vec2 velocity, const ProjectileEmitterComponent& projectileEmitter)
+    {
+        registry.Instantiate(prefab, 1, [&](Entity projectile, int)
+        {
+            projectile.GetComponent<TransformComponent>().position = position;
+            projectile.GetComponent<RigidBodyComponent>().velocity = velocity;
+            projectile.GetComponent<ProjectileComponent>() = ProjectileComponent(
+                projectileEmitter.isFriendly,
+                projectileEmitter.hitPercentDamage,
+                projectileEmitter.projectileDuration
+                );
+        });
+    }
+
 public:
     ProjectileEmitSystem()
     {
         RequireComponent<ProjectileEmitterComponent>();
         RequireComponent<TransformComponent>();
+
+        // Projectiles are instantiated straight into the registry
+        SetExclusive(true);
+
+        for (Prefab* prefab : {&playerProjectilePrefab, &projectilePrefab})
+        {
+            prefab->AddComponent<TransformComponent>(glm::vec2(0, 0), glm::vec2(1, 1), 0.0)
+                .AddComponent<RigidBodyComponent>()
+                .AddComponent<BoxColliderComponent>(4, 4)
+                .AddComponent<ProjectileComponent>()
+                .Group("projectiles");
+        }
+        playerProjectilePrefab.AddComponent<SpriteComponent>("bullet-texture", 4, 4, 1);
+        projectilePrefab.AddComponent<SpriteComponent>("bullet-texture", 4, 4, 4);
     }
 
     void SubscribeToEvents(std::unique_ptr<EventBus>& eventBus)
     {
-        eventBus->SubscribeToEvent<KeyPressedEvent>(this, &ProjectileEmitSystem::OnKeyPress);
+        keyPressedSubscription = eventBus->SubscribeToEvent<&ProjectileEmitSystem::OnKeyPress>(this);
     }
 
     void OnKeyPress(KeyPressedEvent& event)
@@ -30,16 +70,16 @@ public:
         {
             for (auto entity : GetSystemEntities())
             {
-                if (entity.HasTag("player"))
+                if (entity.HasTag(playerTag))
                 {
-                    const auto projectileEmitter = entity.GetComponent<ProjectileEmitterComponent>();
-                    const auto transform = entity.GetComponent<TransformComponent>();
-                    const auto rigidBody = entity.GetComponent<RigidBodyComponent>();
+                    const auto& projectileEmitter = entity.GetComponent<const ProjectileEmitterComponent>();
+                    const auto transform = entity.GetComponent<const TransformComponent>();
+                    const auto rigidBody = entity.GetComponent<const RigidBodyComponent>();
 
                     glm::vec2 projectilePosition = transform.position;
                     if (entity.HasComponent<SpriteComponent>())
                     {
-                        auto sprite = entity.GetComponent<SpriteComponent>();
+                        const auto sprite = entity.GetComponent<const SpriteComponent>();
                         projectilePosition.x += transform.scale.x * sprite.width / 2;
                         projectilePosition.y += transform.scale.y * sprite.height / 2;
                     }
@@ -55,17 +95,7 @@ public:
                     projectileVelocity.y = projectileEmitter.projectileVelocity.y * directionY;
                     
                     // Create a new projectile.
-                    auto projectile = entity.registry->CreateEntity();
-                    projectile.Group("projectiles");
-                    projectile.AddComponent<TransformComponent>(projectilePosition, glm::vec2(1, 1), 0.0);
-                    projectile.AddComponent<RigidBodyComponent>(projectileVelocity);
-                    projectile.AddComponent<SpriteComponent>("bullet-texture", 4, 4, 1);
-                    projectile.AddComponent<BoxColliderComponent>(4, 4);
-                    projectile.AddComponent<ProjectileComponent>(
-                        projectileEmitter.isFriendly,
-                        projectileEmitter.hitPercentDamage,
-                        projectileEmitter.projectileDuration
-                        );
+                    SpawnProjectile(*entity.registry, playerProjectilePrefab, projectilePosition, projectileVelocity, projectileEmitter);
                 }
             }
         }
@@ -75,38 +105,28 @@ public:
     {
         for (auto entity : GetSystemEntities())
         {
-            auto& projectileEmitter = entity.GetComponent<ProjectileEmitterComponent>();
-            const auto transform = entity.GetComponent<TransformComponent>();
+            const auto& projectileEmitter = entity.GetComponent<const ProjectileEmitterComponent>();
+            const auto transform = entity.GetComponent<const TransformComponent>();
 
             if (projectileEmitter.repeatFrequency == 0)
                 continue;
             
             // Check if its time to re-emit a new projectile.
-            if (SDL_GetTicks() - projectileEmitter.lastEmissionTime > projectileEmitter.repeatFrequency)
+            if (SimulationTime::GetTicks() - projectileEmitter.lastEmissionTime > projectileEmitter.repeatFrequency)
             {
                 glm::vec2 projectilePosition = transform.position;
                 if (entity.HasComponent<SpriteComponent>())
                 {
-                    auto sprite = entity.GetComponent<SpriteComponent>();
+                    const auto sprite = entity.GetComponent<const SpriteComponent>();
                     projectilePosition.x += transform.scale.x * sprite.width / 2;
                     projectilePosition.y += transform.scale.y * sprite.height / 2;
                 }
                 
                 // Create a new projectile.
-                auto projectile = registry->CreateEntity();
-                projectile.Group("projectiles");
-                projectile.AddComponent<TransformComponent>(projectilePosition, glm::vec2(1, 1), 0.0);
-                projectile.AddComponent<RigidBodyComponent>(projectileEmitter.projectileVelocity);
-                projectile.AddComponent<SpriteComponent>("bullet-texture", 4, 4, 4);
-                projectile.AddComponent<BoxColliderComponent>(4, 4);
-                projectile.AddComponent<ProjectileComponent>(
-                    projectileEmitter.isFriendly,
-                    projectileEmitter.hitPercentDamage,
-                    projectileEmitter.projectileDuration
-                    );
+                SpawnProjectile(*registry, projectilePrefab, projectilePosition, projectileEmitter.projectileVelocity, projectileEmitter);
 
                 // Update the projectile emitter component's last emission time to the current milliseconds.
-                projectileEmitter.lastEmissionTime = SDL_GetTicks();
+                entity.GetComponent<ProjectileEmitterComponent>().lastEmissionTime = SimulationTime::GetTicks();
             }
         }
     }
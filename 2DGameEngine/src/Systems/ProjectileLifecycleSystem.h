@@ -3,6 +3,7 @@
 #include <SDL.h>
 
 #include "../Components/ProjectileComponent.h"
+#include "../Game/SimulationTime.h"
 #include "../ECS/ECS.h"
 
 class ProjectileLifecycleSystem : public System
@@ -11,16 +12,18 @@ public:
     ProjectileLifecycleSystem()
     {
         RequireComponent<ProjectileComponent>();
+
+        ReadsComponent<ProjectileComponent>();
     }
 
-    void Update()
+    void Update(CommandBuffer& commands)
     {
         for (auto entity : GetSystemEntities())
         {
-            auto projectile = entity.GetComponent<ProjectileComponent>();
-            if (SDL_GetTicks() - projectile.startTime > projectile.duration)
+            const auto& projectile = entity.GetComponent<const ProjectileComponent>();
+            if (SimulationTime::GetTicks() - projectile.startTime > projectile.duration)
             {
-                entity.Kill();
+                commands.KillEntity(entity);
             }
         }
     }
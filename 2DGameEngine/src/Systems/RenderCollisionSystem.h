@@ -5,6 +5,7 @@
 #include "../Components/BoxColliderComponent.h"
 #include "../Components/TransformComponent.h"
 #include "../ECS/ECS.h"
+#include "TransformInterpolationSystem.h"
 
 class RenderCollisionSystem : public System
 {
@@ -15,12 +16,12 @@ public:
         RequireComponent<BoxColliderComponent>();
     }
 
-    void Update(SDL_Renderer* renderer, SDL_Rect& camera)
+    void Update(SDL_Renderer* renderer, const TransformInterpolationSystem& interpolation, SDL_Rect& camera)
     {
         for (auto entity : GetSystemEntities())
         {
-            const auto transform = entity.GetComponent<TransformComponent>();
-            const auto collider = entity.GetComponent<BoxColliderComponent>();
+            const auto transform = interpolation.Interpolate(entity, entity.GetComponent<const TransformComponent>());
+            const auto& collider = entity.GetComponent<const BoxColliderComponent>();
 
             SDL_Rect colliderRect = {
                 static_cast<int>(transform.position.x + collider.offset.x - camera.x),
@@ -1,9 +1,15 @@
 #pragma once
 
 #include "../ECS/ECS.h"
+#include "../Scheduler/SystemScheduler.h"
+#include "../Profiler/Profiler.h"
+#include "../Game/StressSceneGenerator.h"
 
 #include <SDL.h>
 
+#include <algorithm>
+#include <cstdio>
+
 #include <imgui/imgui.h>
 #include <imgui/imgui_impl_sdl2.h>
 #include <imgui/imgui_impl_sdlrenderer2.h>
@@ -24,7 +30,7 @@ class RenderDebugGuiSystem : public System
 public:
     RenderDebugGuiSystem() = default;
 
-    void Update(SDL_Renderer* renderer, const std::unique_ptr<Registry>& registry, const SDL_Rect& camera)
+    void Update(SDL_Renderer* renderer, const std::unique_ptr<Registry>& registry, const SystemScheduler& scheduler, sol::state& lua, const SDL_Rect& camera)
     {
         ImGui_ImplSDLRenderer2_NewFrame();
         ImGui_ImplSDL2_NewFrame();
@@ -111,6 +117,30 @@ public:
                 enemy.AddComponent<ProjectileEmitterComponent>(glm::vec2(velX, velY), projectilesRepeat*1000, projectileDuration*1000, projectileDamage, projectileIsFriendly);
                 enemy.AddComponent<HealthComponent>(initialHealth);
             }
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
+            // Many enemies and obstacles at once, the same settings always give the same scene
+            static StressSceneSettings stressScene;
+            if (ImGui::CollapsingHeader("Stress scene"))
+            {
+                ImGui::InputScalar("Seed", ImGuiDataType_U32, &stressScene.seed);
+                ImGui::InputInt("Tanks", &stressScene.numTanks);
+                ImGui::InputInt("Planes", &stressScene.numPlanes);
+                ImGui::InputInt("Obstacles", &stressScene.numObstacles);
+                ImGui::InputInt2("Map tiles (rows, cols)", &stressScene.mapNumRows);
+                if (ImGui::Button("Spawn stress scene"))
+                {
+                    StressSceneGenerator::Spawn(stressScene, registry, lua);
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Write level"))
+                {
+                    StressSceneGenerator::WriteLevel(stressScene, "assets/scripts/Stress.lua");
+                }
+            }
         }
         ImGui::End();
 
@@ -126,6 +156,62 @@ public:
             );
         }
         ImGui::End();
+
+        // Display the stages of the system scheduler, the systems of a stage run at the same time
+        if (ImGui::Begin("Systems schedule", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
+        {
+            ImGui::Text("Frame update: %.3f ms in %d stages", scheduler.GetLastDurationMs(), scheduler.GetNumStages());
+            for (int stage = 0; stage < scheduler.GetNumStages(); stage++)
+            {
+                ImGui::Separator();
+                ImGui::Text("Stage %d", stage);
+                for (const auto& step : scheduler.GetSteps())
+                {
+                    if (step.stage != stage)
+                        continue;
+                    ImGui::BulletText("%s%s: %.3f ms", step.name.c_str(), step.system->IsExclusive() ? " (exclusive)" : "", step.lastDurationMs);
+                }
+            }
+        }
+        ImGui::End();
+
+        // Display the time of the last frames and how the last one was spent, nested zones are indented
+        if (ImGui::Begin("Profiler", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
+        {
+            const auto frameTimes = Profiler::GetFrameTimes();
+            float averageMs = 0.0f;
+            float maxMs = 0.0f;
+            for (float frameMs : frameTimes)
+            {
+                averageMs += frameMs;
+                maxMs = std::max(maxMs, frameMs);
+            }
+            averageMs = frameTimes.empty() ? 0.0f : averageMs / frameTimes.size();
+
+            char overlay[64];
+            std::snprintf(overlay, sizeof(overlay), "avg %.2f ms, max %.2f ms", averageMs, maxMs);
+            ImGui::PlotLines("Frame", frameTimes.data(), static_cast<int>(frameTimes.size()), 0, overlay, 0.0f, std::max(maxMs, 1000.0f / 60.0f), ImVec2(320, 60));
+
+            const float lastFrameMs = frameTimes.empty() ? 0.0f : frameTimes.back();
+            for (const auto& zone : Profiler::GetLastFrameZones())
+            {
+                char label[64];
+                std::snprintf(label, sizeof(label), "%.3f ms", zone.milliseconds);
+                ImGui::SetCursorPosX(ImGui::GetCursorPosX() + zone.depth * 10.0f);
+                ImGui::ProgressBar(lastFrameMs > 0.0f ? static_cast<float>(zone.milliseconds / lastFrameMs) : 0.0f, ImVec2(160, 0), label);
+                ImGui::SameLine();
+                ImGui::TextUnformatted(zone.name);
+            }
+
+            ImGui::Separator();
+            static int numTraceFrames = 60;
+            ImGui::SliderInt("Frames", &numTraceFrames, 1, Profiler::MAX_FRAMES);
+            if (ImGui::Button("Export trace"))
+            {
+                Profiler::ExportTrace("trace.json", numTraceFrames);
+            }
+        }
+        ImGui::End();
         
         ImGui::Render();
         ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData(), renderer);
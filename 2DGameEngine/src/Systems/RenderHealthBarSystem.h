@@ -5,6 +5,7 @@
 #include "../Components/SpriteComponent.h"
 #include "../AssetStore/AssetStore.h"
 #include "../ECS/ECS.h"
+#include "TransformInterpolationSystem.h"
 
 #include <SDL.h>
 
@@ -18,13 +19,13 @@ public:
         RequireComponent<SpriteComponent>();
     }
 
-    void Update(SDL_Renderer* renderer, std::unique_ptr<AssetStore>& assetStore, const SDL_Rect& camera)
+    void Update(SDL_Renderer* renderer, std::unique_ptr<AssetStore>& assetStore, const TransformInterpolationSystem& interpolation, const SDL_Rect& camera)
     {
         for (auto entity : GetSystemEntities())
         {
-            const auto transform = entity.GetComponent<TransformComponent>();
-            const auto sprite = entity.GetComponent<SpriteComponent>();
-            const auto health = entity.GetComponent<HealthComponent>();
+            const auto transform = interpolation.Interpolate(entity, entity.GetComponent<const TransformComponent>());
+            const auto& sprite = entity.GetComponent<const SpriteComponent>();
+            const auto& health = entity.GetComponent<const HealthComponent>();
 
             // Draw the health bar with the correct color for the percentage
             SDL_Color healthBarColor = {255, 255, 255, 255};
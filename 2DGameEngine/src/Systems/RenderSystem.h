@@ -7,56 +7,107 @@
 #include "../Components/SpriteComponent.h"
 #include "../AssetStore/AssetStore.h"
 #include "../ECS/ECS.h"
+#include "../Jobs/JobSystem.h"
+#include "TransformInterpolationSystem.h"
 
 class RenderSystem: public System
 {
+private:
+    // Entities sorted by z-index, only rebuilt when entities join/leave or a sprite changes its z-index
+    std::vector<Entity> renderQueue;
+
+    // Z-index every entity had when the queue was sorted [Vector index = entity id]
+    std::vector<int> queuedZIndices;
+
+    // Whether each entity of the render queue is inside the camera view this frame [Vector index = queue index]
+    std::vector<std::uint8_t> isVisible;
+
+    std::uint32_t queuedMembershipVersion = 0;
+    std::uint32_t lastChangeTick = 0;
+    bool isQueueBuilt = false;
+
+    bool IsRenderQueueOutdated(const std::unique_ptr<Registry>& registry)
+    {
+        if (!isQueueBuilt || queuedMembershipVersion != GetMembershipVersion())
+            return true;
+
+        // Only the sprites written since the last frame can have moved to another layer
+        bool hasZIndexChanged = false;
+        registry->View<const TransformComponent, const SpriteComponent>().Changed<SpriteComponent>(lastChangeTick).Each(GetSystemEntities(),
+            [&](Entity entity, const TransformComponent&, const SpriteComponent& sprite)
+            {
+                hasZIndexChanged |= queuedZIndices[entity.GetId()] != sprite.zIndex;
+            }
+        );
+        return hasZIndexChanged;
+    }
+
+    void RebuildRenderQueue(const std::unique_ptr<Registry>& registry)
+    {
+        renderQueue = GetSystemEntities();
+        registry->View<const TransformComponent, const SpriteComponent>().Each(renderQueue, [&](Entity entity, const TransformComponent&, const SpriteComponent& sprite)
+        {
+            if (entity.GetId() >= static_cast<int>(queuedZIndices.size()))
+                queuedZIndices.resize(entity.GetId() + 1);
+            queuedZIndices[entity.GetId()] = sprite.zIndex;
+        });
+
+        // Sort the entities by z-index (keeping the spawn order between equal z-indexes)
+        std::stable_sort(renderQueue.begin(), renderQueue.end(),
+            [this](Entity a, Entity b) {
+                return queuedZIndices[a.GetId()] < queuedZIndices[b.GetId()];
+            }
+        );
+
+        queuedMembershipVersion = GetMembershipVersion();
+        isQueueBuilt = true;
+    }
+
 public:
     RenderSystem()
     {
         RequireComponent<TransformComponent>();
         RequireComponent<SpriteComponent>();
+
+        // Sprites with the same z-index are drawn in the order they were spawned
+        SetStableOrder(true);
     }
 
-    void Update(SDL_Renderer* renderer, std::unique_ptr<AssetStore>& assetStore, SDL_Rect& camera)
+    void Update(SDL_Renderer* renderer, const std::unique_ptr<Registry>& registry, JobSystem& jobSystem, std::unique_ptr<AssetStore>& assetStore, const TransformInterpolationSystem& interpolation, SDL_Rect& camera)
     {
-        // Create a vector with both Sprite and Transform component of all entities
-        struct RenderableEntity
-        {
-            TransformComponent transformComponent;
-            SpriteComponent spriteComponent;
-        };
-        std::vector<RenderableEntity> renderableEntities; 
-        for (auto entity: GetSystemEntities())
+        if (IsRenderQueueOutdated(registry))
+            RebuildRenderQueue(registry);
+        lastChangeTick = registry->GetChangeTick();
+
+        // Cull the entities outside the camera view on the job system, drawing stays on this thread
+        const int numQueued = static_cast<int>(renderQueue.size());
+        isVisible.resize(numQueued);
+        jobSystem.Wait(jobSystem.ParallelFor(numQueued, JobSystem::GetBatchSize<std::uint8_t>(1024), [&](int begin, int end)
         {
-            RenderableEntity renderableEntity;
-            renderableEntity.spriteComponent = entity.GetComponent<SpriteComponent>();
-            renderableEntity.transformComponent = entity.GetComponent<TransformComponent>();
-
-            // Bypass rendering entities if they're outside the camera view
-            bool isEntityOutsideCameraView = (
-                renderableEntity.transformComponent.position.x + (renderableEntity.transformComponent.scale.x * renderableEntity.spriteComponent.width) < camera.x ||
-                renderableEntity.transformComponent.position.x > camera.x + camera.w ||
-                renderableEntity.transformComponent.position.y + (renderableEntity.transformComponent.scale.y * renderableEntity.spriteComponent.height) < camera.y ||
-                renderableEntity.transformComponent.position.y > camera.y + camera.h
-            );
-            if (isEntityOutsideCameraView && !renderableEntity.spriteComponent.isFixed)
-                continue;
-            
-            renderableEntities.emplace_back(renderableEntity);
-        }
+            for (int i = begin; i < end; i++)
+            {
+                const auto transform = interpolation.Interpolate(renderQueue[i], registry->GetComponent<const TransformComponent>(renderQueue[i]));
+                const auto& sprite = registry->GetComponent<const SpriteComponent>(renderQueue[i]);
 
-        // Sort the vector by the z-index value
-        std::sort(renderableEntities.begin(), renderableEntities.end(),
-            [](const RenderableEntity& a, const RenderableEntity& b) {
-                return a.spriteComponent.zIndex < b.spriteComponent.zIndex;
+                // Bypass rendering entities if they're outside the camera view
+                bool isEntityOutsideCameraView = (
+                    transform.position.x + (transform.scale.x * sprite.width) < camera.x ||
+                    transform.position.x > camera.x + camera.w ||
+                    transform.position.y + (transform.scale.y * sprite.height) < camera.y ||
+                    transform.position.y > camera.y + camera.h
+                );
+                isVisible[i] = !isEntityOutsideCameraView || sprite.isFixed;
             }
-        );
+        }));
 
-        // Loop all entities that the system is interested in
-        for (auto entity: renderableEntities)
+        // Loop all the visible entities, back to front
+        for (int i = 0; i < numQueued; i++)
         {
-            const auto transform = entity.transformComponent;
-            const auto sprite = entity.spriteComponent;
+            if (!isVisible[i])
+                continue;
+
+            const auto transform = interpolation.Interpolate(renderQueue[i], registry->GetComponent<const TransformComponent>(renderQueue[i]));
+            const auto& sprite = registry->GetComponent<const SpriteComponent>(renderQueue[i]);
 
             // Set the source rectangle of our original sprite texture
             SDL_Rect srcRect = sprite.srcRect;
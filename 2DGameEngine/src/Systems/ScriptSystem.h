@@ -11,7 +11,7 @@ std::tuple<double, double> GetEntityPosition(Entity entity)
 {
     if (entity.HasComponent<TransformComponent>())
     {
-        const auto transform = entity.GetComponent<TransformComponent>();
+        const auto& transform = entity.GetComponent<const TransformComponent>();
         return std::make_tuple(transform.position.x, transform.position.y);
     }
     else
@@ -25,7 +25,7 @@ std::tuple<double, double> GetEntityVelocity(Entity entity)
 {
     if (entity.HasComponent<RigidBodyComponent>())
     {
-        const auto rigidBody = entity.GetComponent<RigidBodyComponent>();
+        const auto& rigidBody = entity.GetComponent<const RigidBodyComponent>();
         return std::make_tuple(rigidBody.velocity.x, rigidBody.velocity.y);
     }
     else
@@ -109,6 +109,9 @@ public:
     ScriptSystem()
     {
         RequireComponent<ScriptComponent>();
+
+        // The Lua state is not thread safe, and scripts can change any component or destroy entities
+        SetExclusive(true);
     }
 
     void CreateLuaBindings(sol::state& lua)
@@ -118,8 +121,9 @@ public:
             "entity",
             "get_id", &Entity::GetId,
             "destroy", &Entity::Kill,
-            "has_tag", &Entity::HasTag,
-            "belongs_to_group", &Entity::BelongsToGroup
+            "is_alive", &Entity::IsAlive,
+            "has_tag", sol::resolve<bool(const std::string&) const>(&Entity::HasTag),
+            "belongs_to_group", sol::resolve<bool(const std::string&) const>(&Entity::BelongsToGroup)
             );
         
         // Create all the bindings between C++ and Lua functions
@@ -137,7 +141,7 @@ public:
         // Loop all the entities that have a script component and invoke their Lua function
         for (auto entity : GetSystemEntities())
         {
-            auto& script = entity.GetComponent<ScriptComponent>();
+            const auto& script = entity.GetComponent<const ScriptComponent>();
             script.func(entity, deltaTime, ellapsedTime); // here is where we invoke a sol::function
         }
     }
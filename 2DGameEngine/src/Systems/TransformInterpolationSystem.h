@@ -0,0 +1,82 @@
+#pragma once
+
+#include <SDL_rect.h>
+#include <glm/glm.hpp>
+
+#include "../Components/TransformComponent.h"
+#include "../ECS/ECS.h"
+
+class TransformInterpolationSystem : public System
+{
+private:
+    struct TransformState
+    {
+        glm::vec2 position;
+        std::uint32_t generation;
+        bool isSaved;
+    };
+
+    // Position every entity had at the start of the last simulation step [Vector index = entity id]
+    std::vector<TransformState> previousStates;
+
+    // How far the rendered frame is between the last two simulation steps (0 = previous, 1 = current)
+    double alpha = 1.0;
+
+public:
+    TransformInterpolationSystem()
+    {
+        RequireComponent<TransformComponent>();
+
+        ReadsComponent<TransformComponent>();
+    }
+
+    // Called before every simulation step, so rendering can blend the state before and after it
+    void SaveStates(const std::unique_ptr<Registry>& registry)
+    {
+        for (auto& state : previousStates)
+        {
+            state.isSaved = false;
+        }
+
+        registry->View<const TransformComponent>().Each(GetSystemEntities(), [this](Entity entity, const TransformComponent& transform)
+        {
+            if (entity.GetId() >= static_cast<int>(previousStates.size()))
+                previousStates.resize(entity.GetId() + 1);
+            previousStates[entity.GetId()] = {transform.position, entity.GetGeneration(), true};
+        });
+    }
+
+    void SetAlpha(double alpha)
+    {
+        this->alpha = alpha;
+    }
+
+    // Returns the transform to render for the entity. Only the position is blended, rotations are flipped
+    // in one go by the scripts and would spin through every angle in between. Entities created during the
+    // last step have no previous state and are rendered where they are.
+    TransformComponent Interpolate(Entity entity, const TransformComponent& transform) const
+    {
+        const auto entityId = entity.GetId();
+        if (entityId >= static_cast<int>(previousStates.size()))
+            return transform;
+
+        const auto& previousState = previousStates[entityId];
+        if (!previousState.isSaved || previousState.generation != entity.GetGeneration())
+            return transform;
+
+        TransformComponent interpolated = transform;
+        interpolated.position = glm::mix(previousState.position, transform.position, static_cast<float>(alpha));
+        return interpolated;
+    }
+
+    // Same blend for state kept outside the registry, such as the camera
+    SDL_Rect Interpolate(const SDL_Rect& previous, const SDL_Rect& current) const
+    {
+        return {
+            static_cast<int>(previous.x + (current.x - previous.x) * alpha),
+            static_cast<int>(previous.y + (current.y - previous.y) * alpha),
+            current.w,
+            current.h
+        };
+    }
+};
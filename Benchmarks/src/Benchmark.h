@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * @name Stopwatch
+ * @brief Measures the wall-clock time elapsed since it was created or last restarted.
+ */
+class Stopwatch
+{
+public:
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+    void Restart() { start = std::chrono::steady_clock::now(); }
+
+    double ElapsedMilliseconds() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+// Keeps the optimizer from discarding a value that is only computed for the benchmark
+template <typename T>
+void DoNotOptimize(const T& value)
+{
+    [[maybe_unused]] static const void* volatile sink;
+    sink = &value;
+}
+
+// Number of calls to the global operator new since the program started (see AllocationCounter.cpp)
+std::uint64_t GetNumAllocations();
+
+// Each benchmark suite is a free function invoked from Main.cpp
+void RunStorageBenchmark();
+void RunJobsBenchmark();
+void RunEcsBenchmark();
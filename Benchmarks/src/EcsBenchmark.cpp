@@ -0,0 +1,174 @@
+#include "Benchmark.h"
+
+#include <vector>
+
+#include "../../2DGameEngine/src/ECS/ECS.h"
+#include "../../2DGameEngine/src/EventBus/EventBus.h"
+#include "../../2DGameEngine/src/Events/CollisionEvent.h"
+#include "../../2DGameEngine/src/Components/TransformComponent.h"
+#include "../../2DGameEngine/src/Components/RigidBodyComponent.h"
+#include "../../2DGameEngine/src/Components/SpriteComponent.h"
+
+/**
+ * Baseline cost of the ECS and event primitives the game calls every frame, at 1k to 1M entities.
+ * Every operation is timed over all the entities of the registry and reported per call, together
+ * with the number of heap allocations per call counted by AllocationCounter.cpp.
+ */
+
+class BenchmarkTransformSystem : public System
+{
+public:
+    BenchmarkTransformSystem()
+    {
+        RequireComponent<TransformComponent>();
+    }
+};
+
+class BenchmarkCollisionListener
+{
+public:
+    int numCollisions = 0;
+
+    void OnCollision(const CollisionEvent& event)
+    {
+        numCollisions += event.a.GetId() != event.b.GetId();
+    }
+};
+
+template <typename TFunction>
+static void Measure(const char* operation, int numEntities, int numCalls, TFunction function)
+{
+    const std::uint64_t allocationsBefore = GetNumAllocations();
+    Stopwatch stopwatch;
+    function();
+    const double milliseconds = stopwatch.ElapsedMilliseconds();
+    const std::uint64_t numAllocations = GetNumAllocations() - allocationsBefore;
+
+    std::printf("%-24s %9d %12.1f %14.3f\n",
+        operation,
+        numEntities,
+        milliseconds * 1000000.0 / numCalls,
+        static_cast<double>(numAllocations) / numCalls
+    );
+}
+
+static void RunScale(int numEntities)
+{
+    Registry registry;
+    registry.AddSystem<BenchmarkTransformSystem>();
+    std::vector<Entity> entities;
+    entities.reserve(numEntities);
+
+    Measure("CreateEntity", numEntities, numEntities, [&]() {
+        for (int i = 0; i < numEntities; i++)
+        {
+            entities.push_back(registry.CreateEntity());
+        }
+    });
+
+    // Two components per entity, reported per AddComponent call
+    Measure("AddComponent", numEntities, numEntities * 2, [&]() {
+        for (int i = 0; i < numEntities; i++)
+        {
+            entities[i].AddComponent<TransformComponent>(glm::vec2(i % 1000, i / 1000), glm::vec2(1, 1), 0.0);
+            entities[i].AddComponent<RigidBodyComponent>(glm::vec2(10, 20));
+        }
+    });
+
+    Measure("Update (add to systems)", numEntities, numEntities, [&]() {
+        registry.Update();
+    });
+
+    Measure("GetComponent", numEntities, numEntities, [&]() {
+        float sum = 0.0f;
+        for (const auto& entity : entities)
+        {
+            sum += entity.GetComponent<TransformComponent>().position.x;
+        }
+        DoNotOptimize(sum);
+    });
+
+    // Half of the calls ask for a component the entities have, half for one they don't
+    Measure("HasComponent", numEntities, numEntities * 2, [&]() {
+        int count = 0;
+        for (const auto& entity : entities)
+        {
+            count += entity.HasComponent<RigidBodyComponent>();
+            count += entity.HasComponent<SpriteComponent>();
+        }
+        DoNotOptimize(count);
+    });
+
+    auto& system = registry.GetSystem<BenchmarkTransformSystem>();
+    Measure("GetSystemEntities loop", numEntities, numEntities, [&]() {
+        float sum = 0.0f;
+        for (auto entity : system.GetSystemEntities())
+        {
+            sum += entity.GetComponent<TransformComponent>().position.y;
+        }
+        DoNotOptimize(sum);
+    });
+
+    Measure("GroupEntity", numEntities, numEntities, [&]() {
+        for (int i = 0; i < numEntities; i++)
+        {
+            entities[i].Group(i % 2 == 0 ? "enemies" : "obstacles");
+        }
+    });
+
+    Measure("BelongsToGroup", numEntities, numEntities, [&]() {
+        int count = 0;
+        for (const auto& entity : entities)
+        {
+            count += entity.BelongsToGroup("enemies");
+        }
+        DoNotOptimize(count);
+    });
+
+    // One subscriber called for every event as soon as it is emitted
+    EventBus eventBus;
+    BenchmarkCollisionListener listener;
+    EventSubscription subscription = eventBus.SubscribeToEvent<&BenchmarkCollisionListener::OnCollision>(&listener);
+    Measure("EmitEvent", numEntities, numEntities, [&]() {
+        for (int i = 0; i < numEntities; i++)
+        {
+            eventBus.EmitEvent<CollisionEvent>(entities[i], entities[numEntities - 1 - i]);
+        }
+    });
+    DoNotOptimize(listener.numCollisions);
+
+    // Same events queued by the producer then read in bulk by the consumer, as the CollisionSystem and the DamageSystem do.
+    // The queue keeps its capacity from one step to the next, it is filled once before measuring.
+    auto& collisionQueue = eventBus.GetEventQueue<CollisionEvent>();
+    auto queueAndDrain = [&]() {
+        for (int i = 0; i < numEntities; i++)
+        {
+            eventBus.QueueEvent<CollisionEvent>(entities[i], entities[numEntities - 1 - i]);
+        }
+        for (const auto& collision : collisionQueue.GetEvents())
+        {
+            listener.OnCollision(collision);
+        }
+        eventBus.ClearQueuedEvents();
+    };
+    queueAndDrain();
+    Measure("QueueEvent + drain", numEntities, numEntities, queueAndDrain);
+    DoNotOptimize(listener.numCollisions);
+
+    Measure("KillEntity + Update", numEntities, numEntities, [&]() {
+        for (const auto& entity : entities)
+        {
+            registry.KillEntity(entity);
+        }
+        registry.Update();
+    });
+}
+
+void RunEcsBenchmark()
+{
+    std::printf("%-24s %9s %12s %14s\n", "operation", "entities", "ns/op", "allocs/op");
+    for (int numEntities : {1000, 10000, 100000, 1000000})
+    {
+        RunScale(numEntities);
+    }
+}
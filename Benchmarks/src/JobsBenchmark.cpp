@@ -0,0 +1,124 @@
+#include "Benchmark.h"
+
+#include <thread>
+#include <vector>
+
+#include "../../2DGameEngine/src/ECS/ECS.h"
+#include "../../2DGameEngine/src/Jobs/JobSystem.h"
+#include "../../2DGameEngine/src/Components/TransformComponent.h"
+#include "../../2DGameEngine/src/Components/RigidBodyComponent.h"
+
+/**
+ * Measures how the job system scales from 1 thread to every hardware thread on two workloads:
+ * the MovementSystem loop over 1M entities split with ParallelFor over the view range, and the
+ * CollisionSystem pair test over 5000 boxes (12.5M pairs, batches of very uneven cost).
+ */
+
+struct Box
+{
+    float x;
+    float y;
+    float width;
+    float height;
+};
+
+static double RunMovement(JobSystem& jobSystem, Registry& registry, int numFrames)
+{
+    const double deltaTime = 1.0 / 60.0;
+    const auto view = registry.View<TransformComponent, const RigidBodyComponent>();
+    const int batchSize = JobSystem::GetBatchSize<TransformComponent>(1024);
+
+    Stopwatch stopwatch;
+    for (int frame = 0; frame < numFrames; frame++)
+    {
+        jobSystem.Wait(jobSystem.ParallelFor(view.GetRangeSize(), batchSize, [&](int begin, int end)
+        {
+            view.Each(begin, end, [deltaTime](Entity, TransformComponent& transform, const RigidBodyComponent& rigidBody) {
+                transform.position += rigidBody.velocity * static_cast<float>(deltaTime);
+            });
+        }));
+    }
+    return stopwatch.ElapsedMilliseconds() / numFrames;
+}
+
+static double RunCollisions(JobSystem& jobSystem, const std::vector<Box>& boxes, int numFrames, int& numCollisions)
+{
+    const int numBoxes = static_cast<int>(boxes.size());
+    const int batchSize = JobSystem::GetBatchSize<Box>(32);
+    std::vector<int> collisionsPerBatch((numBoxes + batchSize - 1) / batchSize);
+
+    Stopwatch stopwatch;
+    for (int frame = 0; frame < numFrames; frame++)
+    {
+        jobSystem.Wait(jobSystem.ParallelFor(numBoxes, batchSize, [&](int begin, int end)
+        {
+            int collisions = 0;
+            for (int i = begin; i < end; i++)
+            {
+                const Box& a = boxes[i];
+                for (int j = i + 1; j < numBoxes; j++)
+                {
+                    const Box& b = boxes[j];
+                    collisions += a.x < b.x + b.width && a.x + a.width > b.x && a.y < b.y + b.height && a.y + a.height > b.y;
+                }
+            }
+            collisionsPerBatch[begin / batchSize] = collisions;
+        }));
+    }
+    const double milliseconds = stopwatch.ElapsedMilliseconds() / numFrames;
+
+    numCollisions = 0;
+    for (int collisions : collisionsPerBatch)
+    {
+        numCollisions += collisions;
+    }
+    return milliseconds;
+}
+
+void RunJobsBenchmark()
+{
+    const int numEntities = 1000000;
+    Registry registry;
+    for (int i = 0; i < numEntities; i++)
+    {
+        Entity entity = registry.CreateEntity();
+        entity.AddComponent<TransformComponent>(glm::vec2(i % 1000, i / 1000), glm::vec2(1, 1), 0.0);
+        entity.AddComponent<RigidBodyComponent>(glm::vec2(10, 20));
+    }
+    registry.Update();
+
+    std::vector<Box> boxes;
+    for (int i = 0; i < 5000; i++)
+    {
+        boxes.push_back({static_cast<float>((i * 37) % 2000), static_cast<float>((i * 91) % 2000), 32.0f, 32.0f});
+    }
+
+    const int maxThreads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    double movementBaseline = 0.0;
+    double collisionsBaseline = 0.0;
+
+    std::printf("%7s %13s %9s %15s %9s %11s\n", "threads", "movement ms", "speedup", "collisions ms", "speedup", "collisions");
+    for (int numThreads = 1; numThreads <= maxThreads; numThreads++)
+    {
+        JobSystem jobSystem(numThreads - 1);
+
+        int numCollisions = 0;
+        const double movementMilliseconds = RunMovement(jobSystem, registry, 20);
+        const double collisionsMilliseconds = RunCollisions(jobSystem, boxes, 5, numCollisions);
+        if (numThreads == 1)
+        {
+            movementBaseline = movementMilliseconds;
+            collisionsBaseline = collisionsMilliseconds;
+        }
+
+        std::printf("%7d %13.3f %8.2fx %15.3f %8.2fx %11d\n",
+            numThreads,
+            movementMilliseconds,
+            movementBaseline / movementMilliseconds,
+            collisionsMilliseconds,
+            collisionsBaseline / collisionsMilliseconds,
+            numCollisions
+        );
+    }
+    DoNotOptimize(registry.GetComponent<TransformComponent>(Entity(1)).position);
+}
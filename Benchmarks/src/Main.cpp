@@ -0,0 +1,37 @@
+#include <cstring>
+#include <cstdio>
+
+#include "Benchmark.h"
+
+struct Suite
+{
+    const char* name;
+    void (*run)();
+};
+
+static const Suite suites[] = {
+    {"storage", RunStorageBenchmark},
+    {"jobs", RunJobsBenchmark},
+    {"ecs", RunEcsBenchmark},
+};
+
+int main(int argc, char* argv[])
+{
+    // Run every suite, or only the ones named on the command line
+    for (const auto& suite : suites)
+    {
+        bool isSelected = argc < 2;
+        for (int i = 1; i < argc; i++)
+        {
+            if (std::strcmp(argv[i], suite.name) == 0)
+                isSelected = true;
+        }
+
+        if (isSelected)
+        {
+            std::printf("==== %s ====\n", suite.name);
+            suite.run();
+        }
+    }
+    return 0;
+}
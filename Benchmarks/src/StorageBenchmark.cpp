@@ -0,0 +1,118 @@
+#include "Benchmark.h"
+
+#include "../../2DGameEngine/src/ECS/ECS.h"
+#include "../../2DGameEngine/src/Components/TransformComponent.h"
+#include "../../2DGameEngine/src/Components/RigidBodyComponent.h"
+#include "../../2DGameEngine/src/Components/SpriteComponent.h"
+
+/**
+ * Compares the per-type component pools against the archetype storage on the MovementSystem workload:
+ * every entity has a Transform and a RigidBody, half of them also have a Sprite, and 10% of the
+ * entities are killed and respawned once so the pools are no longer in entity order.
+ */
+
+class BenchmarkMovementSystem : public System
+{
+public:
+    BenchmarkMovementSystem()
+    {
+        RequireComponent<TransformComponent>();
+        RequireComponent<RigidBodyComponent>();
+    }
+
+    void Update(double deltaTime)
+    {
+        for (auto entity : GetSystemEntities())
+        {
+            auto& transform = entity.GetComponent<TransformComponent>();
+            const auto& rigidBody = entity.GetComponent<RigidBodyComponent>();
+            transform.position += rigidBody.velocity * static_cast<float>(deltaTime);
+        }
+    }
+};
+
+static void SpawnEntity(Registry& registry, int i)
+{
+    Entity entity = registry.CreateEntity();
+    entity.AddComponent<TransformComponent>(glm::vec2(i % 1000, i / 1000), glm::vec2(1, 1), 0.0);
+    entity.AddComponent<RigidBodyComponent>(glm::vec2(10, 20));
+    if (i % 2 == 0)
+        entity.AddComponent<SpriteComponent>("tank-texture", 32, 32, 1);
+}
+
+// How the MovementSystem workload walks the components
+enum class IterationMode
+{
+    SystemList,     // System::GetSystemEntities() + Entity::GetComponent per component
+    View            // Registry::View<TransformComponent, RigidBodyComponent>()
+};
+
+static void RunStorageMode(StorageMode storageMode, IterationMode iterationMode, int numEntities)
+{
+    Registry registry(storageMode);
+    registry.AddSystem<BenchmarkMovementSystem>();
+
+    Stopwatch stopwatch;
+    for (int i = 0; i < numEntities; i++)
+    {
+        SpawnEntity(registry, i);
+    }
+    registry.Update();
+    const double createMilliseconds = stopwatch.ElapsedMilliseconds();
+
+    // Churn: kill every tenth entity and spawn the same amount again, reusing the freed ids
+    for (int i = 0; i < numEntities; i += 10)
+    {
+        registry.KillEntity(Entity(i));
+    }
+    registry.Update();
+    for (int i = 0; i < numEntities; i += 10)
+    {
+        SpawnEntity(registry, i);
+    }
+    registry.Update();
+
+    const int numFrames = numEntities >= 1000000 ? 10 : 50;
+    const double deltaTime = 1.0 / 60.0;
+    auto& movementSystem = registry.GetSystem<BenchmarkMovementSystem>();
+
+    stopwatch.Restart();
+    for (int frame = 0; frame < numFrames; frame++)
+    {
+        if (iterationMode == IterationMode::View)
+        {
+            registry.View<TransformComponent, RigidBodyComponent>().Each(
+                [deltaTime](Entity, TransformComponent& transform, const RigidBodyComponent& rigidBody) {
+                    transform.position += rigidBody.velocity * static_cast<float>(deltaTime);
+                }
+            );
+        }
+        else
+        {
+            movementSystem.Update(deltaTime);
+        }
+    }
+    const double iterateMilliseconds = stopwatch.ElapsedMilliseconds() / numFrames;
+    DoNotOptimize(registry.GetComponent<TransformComponent>(Entity(1)).position);
+
+    std::printf("%-10s %-12s %9d %12.2f %14.3f %12.2f\n",
+        storageMode == StorageMode::Pools ? "pools" : "archetypes",
+        iterationMode == IterationMode::View ? "view" : "system list",
+        numEntities,
+        createMilliseconds,
+        iterateMilliseconds,
+        iterateMilliseconds * 1000000.0 / numEntities
+    );
+}
+
+void RunStorageBenchmark()
+{
+    std::printf("%-10s %-12s %9s %12s %14s %12s\n", "storage", "iteration", "entities", "create ms", "iterate ms", "ns/entity");
+    for (int numEntities : {10000, 100000, 1000000})
+    {
+        RunStorageMode(StorageMode::Pools, IterationMode::SystemList, numEntities);
+        RunStorageMode(StorageMode::Pools, IterationMode::View, numEntities);
+        RunStorageMode(StorageMode::Archetypes, IterationMode::SystemList, numEntities);
+        RunStorageMode(StorageMode::Archetypes, IterationMode::View, numEntities);
+    }
+}